@@ -9,17 +9,57 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    blockstatestorage.cpp \
+    blockstorage.cpp \
     camera.cpp \
+    chunk.cpp \
+    chunkcache.cpp \
+    chunkioservice.cpp \
+    chunkmap.cpp \
+    chunkpool.cpp \
+    chunkscheduler.cpp \
+    chunkserializer.cpp \
+    chunksnapshot.cpp \
+    chunkstorage.cpp \
+    editjournal.cpp \
     inventory.cpp \
+    lightstorage.cpp \
     main.cpp \
-    openglwindow.cpp  # <-- 删除了 mainwindow.cpp
+    openglwindow.cpp \
+    regionfile.cpp \
+    sectionstore.cpp \
+    skylight.cpp \
+    terraingenerator.cpp \
+    worldsettings.cpp \
+    worldview.cpp  # <-- 删除了 mainwindow.cpp
 
 HEADERS += \
     FastNoiseLite.h \
     block.h \
+    blockstatestorage.h \
+    blockstorage.h \
     camera.h \
+    chunk.h \
+    chunkcache.h \
+    chunkioservice.h \
+    chunkmap.h \
+    chunkpool.h \
+    chunkscheduler.h \
+    chunksection.h \
+    chunkserializer.h \
+    chunksnapshot.h \
+    chunkstorage.h \
+    editjournal.h \
+    fnv1a.h \
     inventory.h \
-    openglwindow.h    # <-- 删除了 mainwindow.h
+    lightstorage.h \
+    openglwindow.h \
+    regionfile.h \
+    sectionstore.h \
+    skylight.h \
+    terraingenerator.h \
+    worldsettings.h \
+    worldview.h    # <-- 删除了 mainwindow.h
 
 # FORMS 整个部分都删除了，因为它只包含 mainwindow.ui
 
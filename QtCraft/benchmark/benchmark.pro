@@ -0,0 +1,15 @@
+# 方块存储基准测试：对比调色板压缩存储与原先的稠密数组
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+QT -= gui
+
+INCLUDEPATH += $$PWD/.. $$PWD/../glm
+
+SOURCES += \
+    ../blockstorage.cpp \
+    blockstorage_benchmark.cpp
+
+HEADERS += \
+    ../block.h \
+    ../blockstorage.h
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "blockstorage.h"
+
+// 与 Chunk 保持一致的维度和下标顺序
+namespace {
+const int SIZE_XZ = 16;
+const int HEIGHT = 128;
+const int COLUMN_COUNT = 576; // 默认 24x24 的世界
+const int SEA_LEVEL = 8;
+const int SECTION_SIZE = 16;
+const int SECTION_BLOCK_COUNT = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+const int SECTIONS_PER_COLUMN = HEIGHT / SECTION_SIZE;
+
+struct DenseColumn {
+    uint8_t blocks[SIZE_XZ][HEIGHT][SIZE_XZ];
+};
+
+// 与 Chunk 相同：区块柱切分为 16^3 的子区块，每个子区块有自己的调色板
+struct SectionedColumn {
+    SectionedColumn() : sections(SECTIONS_PER_COLUMN, BlockStorage(SECTION_BLOCK_COUNT)) {}
+
+    BlockType get(int x, int y, int z) const { return sections[y >> 4].get(sectionIndex(x, y, z)); }
+    void set(int x, int y, int z, BlockType type) { sections[y >> 4].set(sectionIndex(x, y, z), type); }
+
+    static int sectionIndex(int x, int y, int z) { return ((y & 15) << 8) | (z << 4) | x; }
+
+    std::vector<BlockStorage> sections;
+};
+
+// 模拟 generateChunk 的分层结构：石头、几层泥土、草皮和海平面以下的水
+BlockType terrainBlock(int y, int terrain_height) {
+    if (y > terrain_height) return y <= SEA_LEVEL ? BlockType::Water : BlockType::Air;
+    if (y == terrain_height && y > SEA_LEVEL) return BlockType::Grass;
+    if (y > terrain_height - 5) return BlockType::Dirt;
+    return BlockType::Stone;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main()
+{
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> height_dist(SEA_LEVEL - 6, SEA_LEVEL + 24);
+    std::vector<int> heights(static_cast<size_t>(COLUMN_COUNT) * SIZE_XZ * SIZE_XZ);
+    for (int& h : heights) h = height_dist(rng);
+
+    std::vector<std::unique_ptr<DenseColumn>> dense;
+    std::vector<std::unique_ptr<SectionedColumn>> paletted;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        auto column = std::make_unique<DenseColumn>();
+        for (int x = 0; x < SIZE_XZ; ++x)
+            for (int z = 0; z < SIZE_XZ; ++z)
+                for (int y = 0; y < HEIGHT; ++y)
+                    column->blocks[x][y][z] = static_cast<uint8_t>(terrainBlock(y, heights[(c * SIZE_XZ + x) * SIZE_XZ + z]));
+        dense.push_back(std::move(column));
+    }
+    double dense_write = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        auto column = std::make_unique<SectionedColumn>();
+        for (int x = 0; x < SIZE_XZ; ++x)
+            for (int z = 0; z < SIZE_XZ; ++z)
+                for (int y = 0; y < HEIGHT; ++y)
+                    column->set(x, y, z, terrainBlock(y, heights[(c * SIZE_XZ + x) * SIZE_XZ + z]));
+        for (BlockStorage& section : column->sections) section.compact();
+        paletted.push_back(std::move(column));
+    }
+    double paletted_write = elapsedMs(start);
+
+    // 按网格构建器的顺序完整扫描一遍
+    uint64_t checksum_dense = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto& column : dense)
+        for (int y = 0; y < HEIGHT; ++y)
+            for (int z = 0; z < SIZE_XZ; ++z)
+                for (int x = 0; x < SIZE_XZ; ++x)
+                    checksum_dense += column->blocks[x][y][z];
+    double dense_sweep = elapsedMs(start);
+
+    uint64_t checksum_paletted = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto& column : paletted)
+        for (const BlockStorage& section : column->sections)
+            for (int i = 0; i < SECTION_BLOCK_COUNT; ++i)
+                checksum_paletted += static_cast<uint8_t>(section.get(i));
+    double paletted_sweep = elapsedMs(start);
+
+    // 光照 BFS 风格的随机访问
+    const int random_reads = 20000000;
+    std::vector<uint32_t> probes(1 << 16);
+    for (uint32_t& p : probes) p = rng();
+
+    uint64_t random_dense = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < random_reads; ++i) {
+        uint32_t p = probes[i & 0xFFFF] ^ static_cast<uint32_t>(i);
+        const DenseColumn& column = *dense[p % COLUMN_COUNT];
+        random_dense += column.blocks[(p >> 8) & 15][(p >> 12) & 127][(p >> 19) & 15];
+    }
+    double dense_random = elapsedMs(start);
+
+    uint64_t random_paletted = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < random_reads; ++i) {
+        uint32_t p = probes[i & 0xFFFF] ^ static_cast<uint32_t>(i);
+        const SectionedColumn& column = *paletted[p % COLUMN_COUNT];
+        random_paletted += static_cast<uint8_t>(column.get((p >> 8) & 15, (p >> 12) & 127, (p >> 19) & 15));
+    }
+    double paletted_random = elapsedMs(start);
+
+    size_t dense_bytes = sizeof(DenseColumn) * dense.size();
+    size_t paletted_bytes = 0;
+    int uniform_sections = 0;
+    for (const auto& column : paletted) {
+        for (const BlockStorage& section : column->sections) {
+            paletted_bytes += sizeof(BlockStorage) + section.memoryUsage();
+            if (section.isUniform()) ++uniform_sections;
+        }
+    }
+
+    std::printf("columns: %d\n", COLUMN_COUNT);
+    std::printf("%-10s %12s %12s %12s %12s\n", "storage", "memory KiB", "write ms", "sweep ms", "random ms");
+    std::printf("%-10s %12zu %12.2f %12.2f %12.2f\n", "dense", dense_bytes / 1024, dense_write, dense_sweep, dense_random);
+    std::printf("%-10s %12zu %12.2f %12.2f %12.2f\n", "paletted", paletted_bytes / 1024, paletted_write, paletted_sweep, paletted_random);
+    std::printf("memory ratio: %.2fx, uniform sections: %d/%d\n", static_cast<double>(dense_bytes) / paletted_bytes,
+                uniform_sections, COLUMN_COUNT * SECTIONS_PER_COLUMN);
+
+    if (checksum_dense != checksum_paletted || random_dense != random_paletted) {
+        std::printf("checksum mismatch: storage contents differ\n");
+        return 1;
+    }
+    return 0;
+}
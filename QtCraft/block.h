@@ -24,6 +24,58 @@ const float AtlasWidth = 5.0f; // 纹理图集包含5个不同的纹理
 const float TileWidth = 1.0f / AtlasWidth;
 }
 
+// 方块的六个面，顺序与网格构建、光照传播中的邻居偏移一致
+enum BlockFace {
+    FACE_POS_Z = 0,
+    FACE_NEG_Z = 1,
+    FACE_POS_Y = 2,
+    FACE_NEG_Y = 3,
+    FACE_POS_X = 4,
+    FACE_NEG_X = 5,
+    FACE_COUNT = 6
+};
+
+// 方块绘制到哪一个网格中
+enum class RenderLayer : uint8_t {
+    None = 0,        // 不绘制
+    Opaque = 1,      // 不透明网格
+    Transparent = 2  // 半透明网格，在不透明网格之后绘制
+};
+
+// 方块属性，所有逻辑都通过查表获得，新增方块类型只需要在下表中加一行
+struct BlockProperties {
+    bool opaque;               // 阻挡天空光，并遮挡相邻方块的面
+    bool solid;                // 参与玩家碰撞
+    bool liquid;               // 液体：暴露在空气下的顶面会略微下沉
+    uint8_t light_attenuation; // 光穿过时减少的等级，不透明方块为 15
+    RenderLayer render_layer;
+    uint8_t face_textures[FACE_COUNT]; // 每个面在纹理图集中的下标
+};
+
+// 按 BlockType 的数值排列
+constexpr BlockProperties BLOCK_PROPERTIES[] = {
+    //            不透明 实心   液体   衰减 渲染层                     各面纹理 (+z, -z, +y, -y, +x, -x)
+    /* Air   */ { false, false, false, 1,   RenderLayer::None,        { 0, 0, 0, 0, 0, 0 } },
+    /* Stone */ { true,  true,  false, 15,  RenderLayer::Opaque,      { Texture::Stone, Texture::Stone, Texture::Stone, Texture::Stone, Texture::Stone, Texture::Stone } },
+    /* Dirt  */ { true,  true,  false, 15,  RenderLayer::Opaque,      { Texture::Dirt, Texture::Dirt, Texture::Dirt, Texture::Dirt, Texture::Dirt, Texture::Dirt } },
+    /* Grass */ { true,  true,  false, 15,  RenderLayer::Opaque,      { Texture::GrassSide, Texture::GrassSide, Texture::GrassTop, Texture::Dirt, Texture::GrassSide, Texture::GrassSide } },
+    /* Water */ { false, false, true,  1,   RenderLayer::Transparent, { Texture::Water, Texture::Water, Texture::Water, Texture::Water, Texture::Water, Texture::Water } },
+};
+
+const int BLOCK_TYPE_COUNT = sizeof(BLOCK_PROPERTIES) / sizeof(BLOCK_PROPERTIES[0]);
+static_assert(BLOCK_TYPE_COUNT == static_cast<int>(BlockType::Water) + 1, "每个 BlockType 都必须在 BLOCK_PROPERTIES 中有一行");
+
+constexpr const BlockProperties& blockProperties(BlockType type) {
+    return BLOCK_PROPERTIES[static_cast<uint8_t>(type)];
+}
+constexpr bool isOpaque(BlockType type) { return blockProperties(type).opaque; }
+constexpr bool isSolid(BlockType type) { return blockProperties(type).solid; }
+
+// 相邻两个方块之间的面是否需要绘制：邻居不透明时被遮挡，同种的透明方块（如水与水）之间也不绘制
+constexpr bool isFaceVisible(BlockType block, BlockType neighbor) {
+    return !isOpaque(neighbor) && neighbor != block;
+}
+
 // --- 顶点定义 ---
 struct Vertex {
     glm::vec3 position;
@@ -0,0 +1,20 @@
+#include "blockstatestorage.h"
+
+void BlockStateStorage::set(int index, uint16_t state)
+{
+    auto it = m_entries.begin() + (lowerBound(index) - m_entries.cbegin());
+    const bool found = it != m_entries.end() && it->index == index;
+
+    if (state == 0) {
+        if (!found) return;
+        m_entries.erase(it);
+        if (m_entries.empty()) clear();
+        return;
+    }
+
+    if (found) {
+        it->state = state;
+    } else {
+        m_entries.insert(it, Entry{static_cast<uint16_t>(index), state});
+    }
+}
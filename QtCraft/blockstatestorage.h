@@ -0,0 +1,51 @@
+#ifndef BLOCKSTATESTORAGE_H
+#define BLOCKSTATESTORAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 稀疏的逐方块状态存储（水位、朝向、生长阶段等）
+// 只为状态非 0 的体素保存一项，按子区块内下标升序排列在连续数组中：
+// 查找用二分，遍历就是顺序扫描，网格构建和 tick 系统都只需要访问这些项。
+// 状态 0 表示默认状态，写入 0 即删除该项，没有任何状态时不占用堆内存。
+class BlockStateStorage {
+public:
+    struct Entry {
+        uint16_t index;
+        uint16_t state;
+    };
+
+    uint16_t get(int index) const {
+        auto it = lowerBound(index);
+        return (it != m_entries.end() && it->index == index) ? it->state : 0;
+    }
+    void set(int index, uint16_t state);
+    void clear() { std::vector<Entry>().swap(m_entries); }
+
+    bool empty() const { return m_entries.empty(); }
+    size_t size() const { return m_entries.size(); }
+
+    // 按下标升序遍历所有非默认状态
+    std::vector<Entry>::const_iterator begin() const { return m_entries.begin(); }
+    std::vector<Entry>::const_iterator end() const { return m_entries.end(); }
+
+    bool operator==(const BlockStateStorage& other) const {
+        return m_entries.size() == other.m_entries.size()
+            && std::equal(m_entries.begin(), m_entries.end(), other.m_entries.begin(),
+                          [](const Entry& a, const Entry& b) { return a.index == b.index && a.state == b.state; });
+    }
+
+    size_t memoryUsage() const { return m_entries.capacity() * sizeof(Entry); }
+
+private:
+    std::vector<Entry>::const_iterator lowerBound(int index) const {
+        return std::lower_bound(m_entries.begin(), m_entries.end(), index,
+                                [](const Entry& entry, int value) { return entry.index < value; });
+    }
+
+    std::vector<Entry> m_entries;
+};
+
+#endif // BLOCKSTATESTORAGE_H
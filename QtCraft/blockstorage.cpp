@@ -0,0 +1,176 @@
+#include "blockstorage.h"
+
+#include <algorithm>
+
+namespace {
+// 能容纳 palette_size 个调色板项的最小下标宽度，只取 0/1/2/4/8
+int bitsForPaletteSize(size_t palette_size) {
+    if (palette_size <= 1) return 0;
+    if (palette_size <= 2) return 1;
+    if (palette_size <= 4) return 2;
+    if (palette_size <= 16) return 4;
+    return 8;
+}
+}
+
+BlockStorage::BlockStorage(int size)
+    : m_size(size)
+{
+    // 调色板通常只有几项，一次预留好，生成时逐项追加不再扩容
+    m_palette.reserve(16);
+    fill(BlockType::Air);
+}
+
+void BlockStorage::fill(BlockType type)
+{
+    // 保留缓冲区的容量：对象池复用区块时，重新生成不需要再分配
+    m_palette.assign(1, type);
+    setBits(0);
+    m_data.assign(wordCount(), 0);
+}
+
+void BlockStorage::set(int index, BlockType type)
+{
+    uint64_t value = static_cast<uint64_t>(findOrAddPaletteEntry(type));
+    if (m_bits == 0) return; // 均一存储且写入的就是唯一的那个类型
+
+    uint64_t& word = m_data[index >> m_index_shift];
+    int bit_offset = (index & m_index_mask) * m_bits;
+    word = (word & ~(m_value_mask << bit_offset)) | (value << bit_offset);
+}
+
+void BlockStorage::compact()
+{
+    bool used[256] = {false};
+    for (int i = 0; i < m_size; ++i) {
+        used[static_cast<uint8_t>(get(i))] = true;
+    }
+
+    // 保留的项按原顺序前移，新下标不大于旧下标，可以原地改写调色板
+    uint8_t remap[256] = {0};
+    size_t kept = 0;
+    for (size_t i = 0; i < m_palette.size(); ++i) {
+        if (used[static_cast<uint8_t>(m_palette[i])]) {
+            remap[i] = static_cast<uint8_t>(kept);
+            m_palette[kept++] = m_palette[i];
+        }
+    }
+
+    if (kept == m_palette.size()) {
+        return;
+    }
+
+    repack(bitsForPaletteSize(kept), remap);
+    m_palette.resize(kept);
+}
+
+bool BlockStorage::loadPacked(int bits, std::vector<BlockType> palette, std::vector<uint64_t> data)
+{
+    if (bits != 0 && bits != 1 && bits != 2 && bits != 4 && bits != 8) return false;
+    if (palette.empty() || palette.size() > (size_t(1) << bits)) return false;
+    for (BlockType type : palette) {
+        if (static_cast<int>(type) >= BLOCK_TYPE_COUNT) return false;
+    }
+
+    const int old_bits = m_bits;
+    setBits(bits);
+    if (data.size() != wordCount()) {
+        setBits(old_bits);
+        return false;
+    }
+    // 下标必须落在调色板之内，否则 get() 会越界读取
+    if (bits != 0) {
+        for (int i = 0; i < m_size; ++i) {
+            uint64_t value = (data[i >> m_index_shift] >> ((i & m_index_mask) * m_bits)) & m_value_mask;
+            if (value >= palette.size()) {
+                setBits(old_bits);
+                return false;
+            }
+        }
+    }
+
+    m_palette = std::move(palette);
+    m_data = std::move(data);
+    return true;
+}
+
+size_t BlockStorage::memoryUsage() const
+{
+    return m_data.capacity() * sizeof(uint64_t) + m_palette.capacity() * sizeof(BlockType);
+}
+
+int BlockStorage::findOrAddPaletteEntry(BlockType type)
+{
+    // 调色板通常只有几项，线性查找比任何哈希结构都快
+    for (size_t i = 0; i < m_palette.size(); ++i) {
+        if (m_palette[i] == type) return static_cast<int>(i);
+    }
+
+    int new_index = static_cast<int>(m_palette.size());
+    if (new_index > static_cast<int>(m_value_mask)) {
+        // 下标宽度只取 0/1/2/4/8，保证一个下标永远不会跨越两个 64 位字
+        uint8_t identity[256];
+        for (size_t i = 0; i < m_palette.size(); ++i) identity[i] = static_cast<uint8_t>(i);
+        repack(m_bits == 0 ? 1 : m_bits * 2, identity);
+    }
+    m_palette.push_back(type);
+    return new_index;
+}
+
+void BlockStorage::repack(int new_bits, const uint8_t* remap)
+{
+    // 原地重新打包，不借助第二块缓冲区，复用的存储只要容量够就不会分配。
+    // 下标宽度都整除 64，第 i 个下标总是从第 i * bits 位开始，可以按位置统一寻址
+    const int old_bits = m_bits;
+    const uint64_t old_value_mask = m_value_mask;
+    setBits(new_bits);
+    if (new_bits == 0) {
+        m_data.assign(wordCount(), 0);
+        return;
+    }
+
+    auto read_old = [&](int i) -> uint64_t {
+        const size_t bit = static_cast<size_t>(i) * old_bits;
+        return (m_data[bit >> 6] >> (bit & 63)) & old_value_mask;
+    };
+    auto write_new = [&](int i, uint64_t value) {
+        const size_t bit = static_cast<size_t>(i) * new_bits;
+        uint64_t& word = m_data[bit >> 6];
+        word = (word & ~(m_value_mask << (bit & 63))) | (value << (bit & 63));
+    };
+
+    if (new_bits > old_bits) {
+        // 第一次展开时按 4 位宽预留，地形子区块很少超过 16 种方块，之后逐级变宽都不再扩容
+        if (old_bits == 0) m_data.reserve(std::max(wordCount(), static_cast<size_t>(m_size) * 4 / 64));
+        // 变宽时从后往前：第 i 项的新位置不早于它的旧位置，也不会覆盖还没读到的前面各项
+        m_data.resize(wordCount(), 0);
+        for (int i = m_size - 1; i >= 0; --i) write_new(i, remap[read_old(i)]);
+    } else {
+        // 变窄或等宽时从前往后，理由相同
+        for (int i = 0; i < m_size; ++i) write_new(i, remap[read_old(i)]);
+        m_data.resize(wordCount());
+    }
+}
+
+void BlockStorage::setBits(int bits)
+{
+    m_bits = bits;
+    if (bits == 0) {
+        m_index_shift = 31;
+        m_index_mask = 0;
+        m_value_mask = 0;
+        return;
+    }
+    int log2_bits = (bits == 1) ? 0 : (bits == 2) ? 1 : (bits == 4) ? 2 : 3;
+    m_index_shift = 6 - log2_bits;
+    m_index_mask = (1 << m_index_shift) - 1;
+    m_value_mask = (uint64_t(1) << bits) - 1;
+}
+
+size_t BlockStorage::wordCount() const
+{
+    // 均一存储也保留一个字，让 get() 的读取路径保持无分支
+    if (m_bits == 0) return 1;
+    // 向上取整：size 不是每字方块数的整数倍时，最后一个字只用到一部分
+    return (static_cast<size_t>(m_size) + m_index_mask) >> m_index_shift;
+}
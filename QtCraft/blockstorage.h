@@ -0,0 +1,65 @@
+#ifndef BLOCKSTORAGE_H
+#define BLOCKSTORAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "block.h"
+
+// 调色板压缩的方块存储
+// 每个体素只保存一个调色板下标，下标按 1/2/4/8 位紧密打包进 64 位字中。
+// 写入新的 BlockType 时调色板会自动扩容，必要时重新打包为更宽的下标。
+// 调色板只有一项时下标宽度为 0，整个存储退化为单个值（均一存储）。
+class BlockStorage {
+public:
+    explicit BlockStorage(int size);
+
+    BlockType get(int index) const {
+        // 均一存储时 m_index_shift 足够大、m_value_mask 为 0，读取总是落在 m_palette[0]，无需分支
+        uint64_t word = m_data[index >> m_index_shift];
+        int bit_offset = (index & m_index_mask) * m_bits;
+        return m_palette[(word >> bit_offset) & m_value_mask];
+    }
+
+    void set(int index, BlockType type);
+
+    // 用单一方块类型填满整个存储，并退化为均一存储。已分配的缓冲区保留容量
+    void fill(BlockType type);
+
+    // 丢弃不再使用的调色板项，并把下标重新打包为能容纳剩余调色板的最小宽度
+    void compact();
+    // 释放缓冲区多余的容量
+    void shrinkToFit() { m_palette.shrink_to_fit(); m_data.shrink_to_fit(); }
+
+    bool isUniform() const { return m_bits == 0; }
+    int size() const { return m_size; }
+    int bitsPerEntry() const { return m_bits; }
+    int paletteSize() const { return static_cast<int>(m_palette.size()); }
+
+    // 打包后的原始数据，用于去重比较和序列化
+    const std::vector<BlockType>& palette() const { return m_palette; }
+    const std::vector<uint64_t>& packedData() const { return m_data; }
+    // 用打包数据整体替换当前内容（反序列化用）。数据不合法时返回 false，原内容保持不变
+    bool loadPacked(int bits, std::vector<BlockType> palette, std::vector<uint64_t> data);
+
+    // 当前占用的堆内存（字节），用于统计和基准测试
+    size_t memoryUsage() const;
+
+private:
+    int findOrAddPaletteEntry(BlockType type);
+    // remap 把旧调色板下标映射为新下标，至少有旧调色板大小那么多项
+    void repack(int new_bits, const uint8_t* remap);
+    void setBits(int bits);
+    size_t wordCount() const;
+
+    int m_size;
+    int m_bits = 0;
+    int m_index_shift = 31;      // index >> m_index_shift 得到所在的 64 位字
+    int m_index_mask = 0;        // index & m_index_mask 得到字内的槽位
+    uint64_t m_value_mask = 0;
+    std::vector<BlockType> m_palette;
+    std::vector<uint64_t> m_data;
+};
+
+#endif // BLOCKSTORAGE_H
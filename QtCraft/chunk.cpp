@@ -0,0 +1,201 @@
+#include "chunk.h"
+#include "fnv1a.h"
+#include "sectionstore.h"
+
+#include <cstring>
+
+namespace {
+// 只含一种方块的子区块的方块哈希，与逐个方块计算的结果相同
+uint64_t uniformBlocksHash(BlockType type)
+{
+    static const std::vector<uint64_t> table = [] {
+        std::vector<uint64_t> hashes(BLOCK_TYPE_COUNT);
+        uint8_t blocks[SECTION_BLOCK_COUNT];
+        for (int type = 0; type < BLOCK_TYPE_COUNT; ++type) {
+            std::memset(blocks, type, sizeof(blocks));
+            hashes[type] = fnv1a(FNV1A_OFFSET_BASIS, blocks, sizeof(blocks));
+        }
+        return hashes;
+    }();
+    return table[static_cast<uint8_t>(type)];
+}
+}
+
+Chunk::Chunk()
+{
+    for (std::shared_ptr<ChunkSection>& section : m_sections) {
+        section = std::make_shared<ChunkSection>();
+    }
+}
+
+Chunk::~Chunk() {
+    if (vbo.isCreated()) vbo.destroy();
+    if (vao.isCreated()) vao.destroy();
+    if (vbo_transparent.isCreated()) vbo_transparent.destroy();
+    if (vao_transparent.isCreated()) vao_transparent.destroy();
+}
+
+void Chunk::reset(std::vector<std::shared_ptr<ChunkSection>>* spare_sections)
+{
+    for (std::shared_ptr<ChunkSection>& section : m_sections) {
+        // 仍被快照或其它区块引用的实例留给它们，本区块换用备用的子区块
+        if (section.use_count() > 1) {
+            if (spare_sections && !spare_sections->empty()) {
+                section = std::move(spare_sections->back());
+                spare_sections->pop_back();
+            } else {
+                section = std::make_shared<ChunkSection>();
+                continue;
+            }
+        }
+        section->blocks.fill(BlockType::Air);
+        section->light.clear();
+        section->states.clear();
+    }
+    vertex_count = 0;
+    vertex_count_transparent = 0;
+    needs_remeshing = true;
+    is_lit = false;
+    insert_sequence = 0;
+    m_generation = 0;
+    m_saved_generation = 0;
+    is_building = false;
+    build_serial = 0;
+    memset(opaque_heightmap, 0, sizeof(opaque_heightmap));
+    memset(surface_heightmap, 0, sizeof(surface_heightmap));
+    coords = glm::ivec3(0);
+    for (Chunk*& neighbor : neighbors) neighbor = nullptr;
+}
+
+void Chunk::releaseSectionMemory()
+{
+    for (std::shared_ptr<ChunkSection>& section : m_sections) {
+        if (section.use_count() == 1) section->shrinkToFit();
+    }
+}
+
+void Chunk::compactSections()
+{
+    // 重新打包不改变内容，不经过 mutableSection：既不推进修改代数，也不复制共享的子区块。
+    // 共享的实例可能正被其它线程上的快照读取，不能原地改写，跳过；两个存储都已均一的子区块无需处理
+    for (std::shared_ptr<ChunkSection>& section : m_sections) {
+        if (section.use_count() > 1) continue;
+        if (section->blocks.isUniform() && section->light.isUniform()) continue;
+        section->compact();
+    }
+}
+
+void Chunk::internSections(SectionStore& store, std::vector<std::shared_ptr<ChunkSection>>* displaced)
+{
+    for (std::shared_ptr<ChunkSection>& section : m_sections) {
+        std::shared_ptr<ChunkSection> shared = store.intern(section);
+        if (shared == section) continue;
+        if (displaced && section.use_count() == 1) displaced->push_back(std::move(section));
+        section = std::move(shared);
+    }
+}
+
+void Chunk::rebuildHeightmaps()
+{
+    const int top = (highestNonEmptySection() + 1) * SECTION_SIZE;
+    for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
+        for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
+            int surface = 0;
+            int opaque = 0;
+            for (int y = top - 1; y >= 0; --y) {
+                BlockType type = getBlock(x, y, z);
+                if (surface == 0 && type != BlockType::Air) surface = y + 1;
+                if (isOpaque(type)) {
+                    opaque = y + 1;
+                    break;
+                }
+            }
+            surface_heightmap[heightmapIndex(x, z)] = static_cast<uint8_t>(surface);
+            opaque_heightmap[heightmapIndex(x, z)] = static_cast<uint8_t>(opaque);
+        }
+    }
+}
+
+void Chunk::updateHeightmaps(int x, int y, int z, BlockType type)
+{
+    // 在最高点以上放置方块时直接抬高；只有移除最高的那个方块时才需要向下扫描，
+    // 因此均摊代价是 O(1)
+    const int column = heightmapIndex(x, z);
+
+    uint8_t& surface = surface_heightmap[column];
+    if (type != BlockType::Air) {
+        if (y >= surface) surface = static_cast<uint8_t>(y + 1);
+    } else if (y + 1 == surface) {
+        int h = y;
+        while (h > 0 && getBlock(x, h - 1, z) == BlockType::Air) --h;
+        surface = static_cast<uint8_t>(h);
+    }
+
+    uint8_t& opaque = opaque_heightmap[column];
+    if (isOpaque(type)) {
+        if (y >= opaque) opaque = static_cast<uint8_t>(y + 1);
+    } else if (y + 1 == opaque) {
+        int h = y;
+        while (h > 0 && !isOpaque(getBlock(x, h - 1, z))) --h;
+        opaque = static_cast<uint8_t>(h);
+    }
+}
+
+int Chunk::lowestSkyExposedSection() const
+{
+    int section_index = SECTIONS_PER_CHUNK;
+    while (section_index > 0) {
+        const ChunkSection& top = section(section_index - 1);
+        if (!top.isUniform()) break;
+        BlockType type = top.uniformBlock();
+        if (isOpaque(type)) break;
+        --section_index;
+    }
+    return section_index;
+}
+
+int Chunk::highestNonEmptySection() const
+{
+    for (int i = SECTIONS_PER_CHUNK - 1; i >= 0; --i) {
+        if (!section(i).isEmpty()) return i;
+    }
+    return -1;
+}
+
+size_t Chunk::blockMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const std::shared_ptr<ChunkSection>& section : m_sections) bytes += section->blocks.memoryUsage();
+    return bytes;
+}
+
+size_t Chunk::lightMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const std::shared_ptr<ChunkSection>& section : m_sections) bytes += section->light.memoryUsage();
+    return bytes;
+}
+
+uint64_t Chunk::contentHash() const
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    uint8_t blocks[SECTION_BLOCK_COUNT];
+    for (const std::shared_ptr<ChunkSection>& section : m_sections) {
+        // 每个子区块先单独求方块哈希，均一子区块直接查表
+        uint64_t blocks_hash;
+        if (section->blocks.isUniform()) {
+            blocks_hash = uniformBlocksHash(section->uniformBlock());
+        } else {
+            for (int i = 0; i < SECTION_BLOCK_COUNT; ++i) blocks[i] = static_cast<uint8_t>(section->blocks.get(i));
+            blocks_hash = fnv1a(FNV1A_OFFSET_BASIS, blocks, sizeof(blocks));
+        }
+        hash = fnv1a(hash, blocks_hash);
+
+        // 非默认状态按下标升序保存，表示方式唯一
+        hash = fnv1a(hash, static_cast<uint64_t>(section->states.size()));
+        for (const BlockStateStorage::Entry& entry : section->states) {
+            hash = fnv1a(hash, (static_cast<uint64_t>(entry.index) << 16) | entry.state);
+        }
+    }
+    return hash;
+}
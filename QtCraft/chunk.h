@@ -0,0 +1,221 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "block.h"
+#include "chunksection.h"
+
+class SectionStore;
+
+// 定义世界和区块的维度常量
+const int CHUNK_SIZE_XZ = 16;
+const int WORLD_HEIGHT_IN_BLOCKS = 128; // 一个区块柱的完整高度
+const int SECTIONS_PER_CHUNK = WORLD_HEIGHT_IN_BLOCKS / SECTION_SIZE;
+
+// 世界坐标与区块坐标的换算：区块边长是 2 的幂，算术右移即向下取整，负坐标同样成立
+const int CHUNK_SHIFT = 4;
+const int CHUNK_MASK = CHUNK_SIZE_XZ - 1;
+static_assert((1 << CHUNK_SHIFT) == CHUNK_SIZE_XZ, "CHUNK_SHIFT 必须与 CHUNK_SIZE_XZ 一致");
+inline int blockToChunk(int world_coord) { return world_coord >> CHUNK_SHIFT; }
+inline int blockToLocal(int world_coord) { return world_coord & CHUNK_MASK; }
+
+// 水平方向上的四个相邻区块
+enum ChunkNeighbor {
+    NEIGHBOR_POS_X = 0,
+    NEIGHBOR_NEG_X = 1,
+    NEIGHBOR_POS_Z = 2,
+    NEIGHBOR_NEG_Z = 3,
+    NEIGHBOR_COUNT = 4
+};
+
+// 与 ChunkNeighbor 顺序一致的 (x, z) 偏移，以及每个方向的反方向
+const int NEIGHBOR_OFFSETS[NEIGHBOR_COUNT][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+const ChunkNeighbor OPPOSITE_NEIGHBOR[NEIGHBOR_COUNT] = {
+    NEIGHBOR_NEG_X, NEIGHBOR_POS_X, NEIGHBOR_NEG_Z, NEIGHBOR_POS_Z
+};
+
+class Chunk {
+public:
+    // 为了方便，保留了旧的常量名，但建议使用新的常量
+    static const int CHUNK_SIZE = CHUNK_SIZE_XZ;
+    static const int CHUNK_HEIGHT = WORLD_HEIGHT_IN_BLOCKS;
+    static const int BLOCK_COUNT = CHUNK_SIZE_XZ * WORLD_HEIGHT_IN_BLOCKS * CHUNK_SIZE_XZ;
+
+    Chunk();
+    ~Chunk();
+
+    // 清空方块、光照和网格状态，供对象池复用；GL 对象和子区块的缓冲区都保留以便再次使用。
+    // 仍被快照或其它区块共享的子区块不能原地清空，换用 spare_sections 中的备用子区块，没有时才新建
+    void reset(std::vector<std::shared_ptr<ChunkSection>>* spare_sections = nullptr);
+    // 释放已重置区块的子区块保留的多余容量
+    void releaseSectionMemory();
+
+    // 局部坐标 -> 所在子区块及其内部下标
+    static int sectionIndex(int y) { return y >> 4; }
+    static int sectionBlockIndex(int x, int y, int z) { return ChunkSection::blockIndex(x, y & (SECTION_SIZE - 1), z); }
+
+    // 子区块按写时复制共享：后台网格任务持有的快照引用旧版本，
+    // 写入前如果旧版本仍被引用，就先复制出一份新版本再修改，读写双方不需要加锁。
+    // 所有写入都经过 mutableSection，它同时推进修改代数；mark_dirty 为 false 只用于
+    // 写入可以随时重新算出来的数据（区块插入世界时计算的光照），不让区块变脏。
+    // 只能在主线程调用。
+    const ChunkSection& section(int index) const { return *m_sections[index]; }
+    ChunkSection& mutableSection(int index, bool mark_dirty = true) {
+        if (mark_dirty) ++m_generation;
+        std::shared_ptr<ChunkSection>& section = m_sections[index];
+        if (section.use_count() > 1) section = std::make_shared<ChunkSection>(*section);
+        return *section;
+    }
+    // 取得子区块当前版本的只读引用，供快照使用
+    std::shared_ptr<const ChunkSection> shareSection(int index) const { return m_sections[index]; }
+    // 整体替换一个子区块（反序列化用），只能在区块还未对其它线程可见时调用。不推进修改代数
+    void setSection(int index, std::shared_ptr<ChunkSection> section) { m_sections[index] = std::move(section); }
+
+    // 脏标记：方块、方块状态和（除插入时计算的以外）光照的每次实际修改都会推进修改代数，
+    // 保存时记下被保存的代数，两者不同说明有未保存的修改
+    uint32_t generation() const { return m_generation; }
+    bool isDirty() const { return m_generation != m_saved_generation; }
+    void markSaved(uint32_t generation) { m_saved_generation = generation; }
+    void markDirty() { m_saved_generation = m_generation - 1; }
+    // 把内容相同的子区块替换为 store 中的共享实例。
+    // 被替换下来、不再有别处引用的子区块放进 displaced，供对象池复用
+    void internSections(SectionStore& store, std::vector<std::shared_ptr<ChunkSection>>* displaced = nullptr);
+
+    BlockType getBlock(int x, int y, int z) const {
+        return section(sectionIndex(y)).blocks.get(sectionBlockIndex(x, y, z));
+    }
+    void setBlock(int x, int y, int z, BlockType type) {
+        // 先比较再写，避免无效写入触发共享子区块的复制
+        if (getBlock(x, y, z) == type) return;
+        ChunkSection& section = mutableSection(sectionIndex(y));
+        const int index = sectionBlockIndex(x, y, z);
+        section.blocks.set(index, type);
+        // 状态属于原来的方块，换成别的方块后恢复默认
+        if (!section.states.empty()) section.states.set(index, 0);
+        updateHeightmaps(x, y, z, type);
+    }
+
+    // 方块的附加状态，0 为默认状态，见 BlockStateStorage
+    uint16_t getBlockState(int x, int y, int z) const {
+        return section(sectionIndex(y)).states.get(sectionBlockIndex(x, y, z));
+    }
+    void setBlockState(int x, int y, int z, uint16_t state) {
+        if (getBlockState(x, y, z) == state) return;
+        mutableSection(sectionIndex(y)).states.set(sectionBlockIndex(x, y, z), state);
+    }
+
+    // 高度图：每列最高的不透明方块 / 最高的非空气方块的 y + 1，整列都没有时为 0。
+    // 不透明高度及以上的体素都直接暴露在天空下。
+    static int heightmapIndex(int x, int z) { return z * CHUNK_SIZE_XZ + x; }
+    int opaqueHeight(int x, int z) const { return opaque_heightmap[heightmapIndex(x, z)]; }
+    int surfaceHeight(int x, int z) const { return surface_heightmap[heightmapIndex(x, z)]; }
+    // 从方块数据重新计算整张高度图
+    void rebuildHeightmaps();
+
+    uint8_t getSkyLight(int x, int y, int z) const {
+        return section(sectionIndex(y)).light.getSkyLight(sectionBlockIndex(x, y, z));
+    }
+    void setSkyLight(int x, int y, int z, uint8_t level, bool mark_dirty = true) {
+        if (getSkyLight(x, y, z) == level) return;
+        mutableSection(sectionIndex(y), mark_dirty).light.setSkyLight(sectionBlockIndex(x, y, z), level);
+    }
+    uint8_t getBlockLight(int x, int y, int z) const {
+        return section(sectionIndex(y)).light.getBlockLight(sectionBlockIndex(x, y, z));
+    }
+    void setBlockLight(int x, int y, int z, uint8_t level) {
+        if (getBlockLight(x, y, z) == level) return;
+        mutableSection(sectionIndex(y)).light.setBlockLight(sectionBlockIndex(x, y, z), level);
+    }
+
+    // 把局部坐标 (x, z) 解析到实际所在的区块：x、z 可以越出本区块一格，
+    // 此时沿邻居链接找到相邻区块（包括对角方向），并把坐标改写为该区块内的局部坐标。
+    // 相邻区块未加载时返回 nullptr。
+    Chunk* resolveNeighbor(int& x, int& z) {
+        Chunk* chunk = this;
+        if (x < 0) { chunk = chunk->neighbors[NEIGHBOR_NEG_X]; x += CHUNK_SIZE_XZ; }
+        else if (x >= CHUNK_SIZE_XZ) { chunk = chunk->neighbors[NEIGHBOR_POS_X]; x -= CHUNK_SIZE_XZ; }
+        if (!chunk) return nullptr;
+        if (z < 0) { chunk = chunk->neighbors[NEIGHBOR_NEG_Z]; z += CHUNK_SIZE_XZ; }
+        else if (z >= CHUNK_SIZE_XZ) { chunk = chunk->neighbors[NEIGHBOR_POS_Z]; z -= CHUNK_SIZE_XZ; }
+        return chunk;
+    }
+    const Chunk* resolveNeighbor(int& x, int& z) const {
+        return const_cast<Chunk*>(this)->resolveNeighbor(x, z);
+    }
+
+    // 可越界一格的读取，世界上下边界外和未加载区块都视为空气/无光
+    BlockType getBlockRelative(int x, int y, int z) const {
+        if (y < 0 || y >= WORLD_HEIGHT_IN_BLOCKS) return BlockType::Air;
+        const Chunk* chunk = resolveNeighbor(x, z);
+        return chunk ? chunk->getBlock(x, y, z) : BlockType::Air;
+    }
+    uint8_t getSkyLightRelative(int x, int y, int z) const {
+        if (y < 0 || y >= WORLD_HEIGHT_IN_BLOCKS) return 0;
+        const Chunk* chunk = resolveNeighbor(x, z);
+        return chunk ? chunk->getSkyLight(x, y, z) : 0;
+    }
+    uint8_t getBlockLightRelative(int x, int y, int z) const {
+        if (y < 0 || y >= WORLD_HEIGHT_IN_BLOCKS) return 0;
+        const Chunk* chunk = resolveNeighbor(x, z);
+        return chunk ? chunk->getBlockLight(x, y, z) : 0;
+    }
+
+    // 把每个子区块尽量压缩为均一存储。只改变表示，不算修改，区块不会因此变脏
+    void compactSections();
+
+    // 从顶部往下连续的、全空气或全水的均一子区块整体暴露在天空下，
+    // 返回其中最低一个的下标；没有这样的子区块时返回 SECTIONS_PER_CHUNK
+    int lowestSkyExposedSection() const;
+    // 最高的非空子区块下标，整列都是空气时返回 -1
+    int highestNonEmptySection() const;
+
+    size_t blockMemoryUsage() const;
+    size_t lightMemoryUsage() const;
+
+    // 方块和方块状态的 64 位指纹（FNV-1a），不含坐标和光照。
+    // 与存储方式（调色板顺序、均一子区块、共享实例）无关，内容相同的区块指纹一定相同，
+    // 用来确认并行、缓存等生成路径与参考实现逐方块一致
+    uint64_t contentHash() const;
+
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer vbo;
+    int vertex_count = 0;
+
+    QOpenGLVertexArrayObject vao_transparent;
+    QOpenGLBuffer vbo_transparent;
+    int vertex_count_transparent = 0;
+
+    bool needs_remeshing = true;
+    // 光照已经算好（从缓存或带光照的存档恢复），插入世界时只需与相邻区块缝合边界
+    bool is_lit = false;
+    // 插入世界时的序号，用来判断插入时入队的天空光是否已经传播完毕
+    uint64_t insert_sequence = 0;
+
+    bool is_building = false;
+    // 每派发一次网格任务递增，与 insert_sequence 一起标识回传的网格属于哪一次构建
+    uint64_t build_serial = 0;
+    glm::ivec3 coords; // y分量将始终为0，代表区块柱的基底
+
+    uint8_t opaque_heightmap[CHUNK_SIZE_XZ * CHUNK_SIZE_XZ] = {0};
+    uint8_t surface_heightmap[CHUNK_SIZE_XZ * CHUNK_SIZE_XZ] = {0};
+
+    // 相邻区块的直接链接，由 ChunkMap 在插入和移除时维护
+    Chunk* neighbors[NEIGHBOR_COUNT] = {nullptr, nullptr, nullptr, nullptr};
+
+private:
+    void updateHeightmaps(int x, int y, int z, BlockType type);
+
+    // 区块柱由若干个 16^3 的子区块组成，全空或只含一种方块的子区块只保存一个值
+    std::shared_ptr<ChunkSection> m_sections[SECTIONS_PER_CHUNK];
+
+    uint32_t m_generation = 0;
+    uint32_t m_saved_generation = 0;
+};
+
+#endif // CHUNK_H
@@ -0,0 +1,63 @@
+#include "chunkcache.h"
+#include "chunkmap.h"
+#include "chunkserializer.h"
+
+ChunkCache::ChunkCache(size_t byte_budget)
+    : m_byte_budget(byte_budget)
+{
+}
+
+void ChunkCache::put(const Chunk& chunk, bool light_settled)
+{
+    const uint64_t key = ChunkMap::packKey(chunk.coords.x, chunk.coords.z);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_bytes -= it->second->data.size();
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    // 没传播完的光照保留下来也是正确的下界，插入时在此基础上重新计算
+    const ChunkSerializer::Light light = light_settled ? ChunkSerializer::Light::Settled : ChunkSerializer::Light::Partial;
+    m_entries.push_front(Entry{key, ChunkSerializer::serialize(chunk, light)});
+    m_index.emplace(key, m_entries.begin());
+    m_bytes += m_entries.front().data.size();
+    evict();
+}
+
+ChunkCache::Entry ChunkCache::take(int x, int z)
+{
+    auto it = m_index.find(ChunkMap::packKey(x, z));
+    if (it == m_index.end()) {
+        ++m_misses;
+        return Entry();
+    }
+
+    Entry entry = std::move(*it->second);
+    m_bytes -= entry.data.size();
+    m_entries.erase(it->second);
+    m_index.erase(it);
+    ++m_hits;
+    return entry;
+}
+
+void ChunkCache::setByteBudget(size_t byte_budget)
+{
+    m_byte_budget = byte_budget;
+    evict();
+}
+
+bool ChunkCache::decode(const Entry& entry, Chunk& chunk)
+{
+    return ChunkSerializer::deserialize(entry.data, chunk);
+}
+
+void ChunkCache::evict()
+{
+    while (m_bytes > m_byte_budget && !m_entries.empty()) {
+        const Entry& oldest = m_entries.back();
+        m_bytes -= oldest.data.size();
+        m_index.erase(oldest.key);
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include <QByteArray>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "chunk.h"
+
+// 最近卸载区块的内存缓存，位于 m_chunks 和存档之间
+// 区块以 ChunkSerializer 的编码保存：方块沿用调色板压缩，光照做行程编码，
+// 因此回到刚离开的区域时只需要解码，不用读盘，也不用重新生成和计算光照。
+// 按字节预算做 LRU 淘汰；被淘汰的区块在卸载时已经提交保存，之后从存档读回。
+// 放入时光照可能还没传播完，这样的区块恢复后仍需重新计算光照（编码中记录了这一点）。
+// 只能在 GUI 线程上使用。
+class ChunkCache {
+public:
+    explicit ChunkCache(size_t byte_budget);
+
+    struct Entry {
+        uint64_t key = 0;
+        QByteArray data;
+
+        bool isValid() const { return !data.isEmpty(); }
+    };
+
+    // 编码并放入缓存，超出预算时淘汰最久未用的区块
+    void put(const Chunk& chunk, bool light_settled);
+    // 取出并移除 (x, z) 处的缓存数据，没有时返回无效的 Entry
+    Entry take(int x, int z);
+    // 把 take() 取出的数据解码到 chunk，chunk->coords 必须已经设置。
+    // 光照已传播完毕的区块解码后 is_lit 为 true
+    static bool decode(const Entry& entry, Chunk& chunk);
+
+    size_t size() const { return m_entries.size(); }
+    size_t memoryUsage() const { return m_bytes; }
+    size_t byteBudget() const { return m_byte_budget; }
+    // 调整字节预算，立即淘汰超出的部分
+    void setByteBudget(size_t byte_budget);
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    void evict();
+
+    size_t m_byte_budget;
+    size_t m_bytes = 0;
+    int m_hits = 0;
+    int m_misses = 0;
+    // 最近放入的在前
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+};
+
+#endif // CHUNKCACHE_H
@@ -0,0 +1,176 @@
+#include "chunkioservice.h"
+#include "chunkserializer.h"
+
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <limits>
+
+int ChunkIOService::RegionQueue::bestPriority() const
+{
+    int best = std::numeric_limits<int>::max();
+    for (const SaveRequest& request : saves) best = std::min(best, request.priority);
+    for (const LoadRequest& request : loads) best = std::min(best, request.priority);
+    return best;
+}
+
+ChunkIOService::ChunkIOService(ChunkStorage* storage, int thread_count,
+                               size_t max_pending_loads, size_t max_pending_saves)
+    : m_storage(storage)
+    , m_max_pending_loads(max_pending_loads)
+    , m_max_pending_saves(max_pending_saves)
+{
+    m_pool.setMaxThreadCount(std::max(thread_count, 1));
+}
+
+ChunkIOService::~ChunkIOService()
+{
+    waitForDone();
+}
+
+uint64_t ChunkIOService::regionKey(const glm::ivec3& coords)
+{
+    const int region_x = RegionFile::regionCoord(coords.x);
+    const int region_z = RegionFile::regionCoord(coords.z);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(region_x)) << 32) | static_cast<uint32_t>(region_z);
+}
+
+bool ChunkIOService::load(Chunk* chunk, int priority, LoadCallback callback)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending_loads >= m_max_pending_loads) return false;
+
+    m_regions[regionKey(chunk->coords)].loads.push_back(LoadRequest{chunk, priority, std::move(callback)});
+    ++m_pending_loads;
+    startWorkerIfNeeded();
+    return true;
+}
+
+bool ChunkIOService::save(const Chunk& chunk, int priority, bool light_settled, SaveCallback callback)
+{
+    // 序列化只是内存拷贝，在锁外完成，不阻塞工作线程取请求
+    QByteArray data = ChunkSerializer::serialize(chunk, light_settled ? ChunkSerializer::Light::Settled
+                                                                      : ChunkSerializer::Light::None);
+
+    QMutexLocker locker(&m_mutex);
+    RegionQueue& queue = m_regions[regionKey(chunk.coords)];
+    for (SaveRequest& request : queue.saves) {
+        if (request.coords.x == chunk.coords.x && request.coords.z == chunk.coords.z) {
+            // 旧数据还没写出去，直接替换
+            request.data = std::move(data);
+            request.priority = std::min(request.priority, priority);
+            if (callback) request.callbacks.push_back(std::move(callback));
+            return true;
+        }
+    }
+    if (m_pending_saves >= m_max_pending_saves) {
+        if (queue.empty() && !queue.busy) m_regions.erase(regionKey(chunk.coords));
+        return false;
+    }
+
+    SaveRequest request{chunk.coords, std::move(data), priority, {}};
+    if (callback) request.callbacks.push_back(std::move(callback));
+    queue.saves.push_back(std::move(request));
+    ++m_pending_saves;
+    startWorkerIfNeeded();
+    return true;
+}
+
+void ChunkIOService::dispatchCompletions()
+{
+    std::vector<Completion> completions;
+    m_mutex.lock();
+    completions.swap(m_completions);
+    m_mutex.unlock();
+
+    for (Completion& completion : completions) {
+        completion.callback(completion.result);
+    }
+}
+
+void ChunkIOService::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+size_t ChunkIOService::pendingLoads()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending_loads;
+}
+
+size_t ChunkIOService::pendingSaves()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending_saves;
+}
+
+void ChunkIOService::startWorkerIfNeeded()
+{
+    // 调用时 m_mutex 已加锁。工作线程做完手上的批次会继续取下一批，
+    // 只有等待的区域多于即将空出来的线程时才需要多开一个
+    if (m_active_workers >= m_pool.maxThreadCount()) return;
+    int waiting_regions = 0;
+    int busy_regions = 0;
+    for (const auto& entry : m_regions) {
+        if (entry.second.busy) ++busy_regions;
+        else if (!entry.second.empty()) ++waiting_regions;
+    }
+    if (waiting_regions <= m_active_workers - busy_regions) return;
+
+    ++m_active_workers;
+    QtConcurrent::run(&m_pool, this, &ChunkIOService::workerLoop);
+}
+
+void ChunkIOService::workerLoop()
+{
+    m_mutex.lock();
+    for (;;) {
+        // 取出优先级最高的空闲区域的全部请求
+        auto best = m_regions.end();
+        int best_priority = std::numeric_limits<int>::max();
+        for (auto it = m_regions.begin(); it != m_regions.end(); ++it) {
+            if (it->second.busy || it->second.empty()) continue;
+            const int priority = it->second.bestPriority();
+            if (best == m_regions.end() || priority < best_priority) {
+                best = it;
+                best_priority = priority;
+            }
+        }
+        if (best == m_regions.end()) break;
+
+        const uint64_t key = best->first;
+        std::vector<SaveRequest> saves;
+        std::vector<LoadRequest> loads;
+        saves.swap(best->second.saves);
+        loads.swap(best->second.loads);
+        best->second.busy = true;
+        m_mutex.unlock();
+
+        // 批内先写后读，这样读到的一定是之前提交的最新数据
+        std::vector<Completion> completions;
+        std::sort(loads.begin(), loads.end(), [](const LoadRequest& a, const LoadRequest& b) {
+            return a.priority < b.priority;
+        });
+        for (SaveRequest& request : saves) {
+            const bool saved = m_storage->saveData(request.coords, request.data);
+            for (SaveCallback& callback : request.callbacks) completions.push_back(Completion{std::move(callback), saved});
+        }
+        // 整批读取前先提示内核预读，后面的读取不再逐个同步等待磁盘
+        for (const LoadRequest& request : loads) m_storage->prefetch(request.chunk->coords);
+        for (LoadRequest& request : loads) {
+            const bool loaded = m_storage->loadChunk(*request.chunk);
+            completions.push_back(Completion{std::move(request.callback), loaded});
+        }
+
+        m_mutex.lock();
+        m_pending_saves -= saves.size();
+        m_pending_loads -= loads.size();
+        for (Completion& completion : completions) m_completions.push_back(std::move(completion));
+        auto it = m_regions.find(key);
+        it->second.busy = false;
+        if (it->second.empty()) m_regions.erase(it);
+    }
+    --m_active_workers;
+    m_mutex.unlock();
+}
@@ -0,0 +1,94 @@
+#ifndef CHUNKIOSERVICE_H
+#define CHUNKIOSERVICE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QThreadPool>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "chunk.h"
+#include "chunkstorage.h"
+
+// 区块读写服务：在自己的小线程池里执行存档读写，GUI 线程只负责提交请求和分发完成回调。
+// - 读、写请求分别有容量上限，队列满时提交失败，由调用者下一帧重试（写请求失败时调用者应当暂不卸载区块）。
+// - 请求按优先级（数值越小越先执行，通常取到玩家的区块距离）调度。
+// - 同一区域文件的请求合并成一批由一个线程连续执行，先写后读，保证读到的是最后一次提交的数据；
+//   同一区域同一时间只有一个线程在访问，RegionFile 本身因此不需要加锁。
+// - 完成回调不在工作线程上调用，而是积累起来，由 GUI 线程调用 dispatchCompletions() 时统一执行。
+class ChunkIOService {
+public:
+    using LoadCallback = std::function<void(bool loaded)>;
+    using SaveCallback = std::function<void(bool saved)>;
+
+    explicit ChunkIOService(ChunkStorage* storage, int thread_count = 2,
+                            size_t max_pending_loads = 64, size_t max_pending_saves = 256);
+    ~ChunkIOService();
+
+    ChunkIOService(const ChunkIOService&) = delete;
+    ChunkIOService& operator=(const ChunkIOService&) = delete;
+
+    // 把 chunk->coords 对应的存档读入 chunk。回调之前 chunk 归工作线程所有，调用者不能访问它。
+    // 回调参数为 false 表示存档中没有该区块或数据损坏（此时 chunk 已重置），调用者应当生成它。
+    bool load(Chunk* chunk, int priority, LoadCallback callback);
+    // 保存区块。数据在调用时序列化，返回之后区块即可归还对象池。
+    // light_settled 为 true 时光照一起写入（见 ChunkStorage::saveChunk）。
+    // 同一区块还在排队的旧数据直接被替换，不占用新的队列容量。被替换请求的回调保留下来，
+    // 等新数据写完后和新请求的回调一起以同一结果调用：回调返回 true 时，提交时的数据一定已经写进区域文件。
+    bool save(const Chunk& chunk, int priority, bool light_settled, SaveCallback callback = SaveCallback());
+
+    // 在 GUI 线程上执行所有已完成请求的回调
+    void dispatchCompletions();
+
+    // 阻塞直到所有已提交的请求执行完毕（不分发回调），用于退出时保存
+    void waitForDone();
+
+    size_t pendingLoads();
+    size_t pendingSaves();
+
+private:
+    struct LoadRequest {
+        Chunk* chunk;
+        int priority;
+        LoadCallback callback;
+    };
+    struct SaveRequest {
+        glm::ivec3 coords;
+        QByteArray data;
+        int priority;
+        std::vector<SaveCallback> callbacks; // 包括被替换的旧请求的回调
+    };
+    // 一个区域文件上排队的请求
+    struct RegionQueue {
+        std::vector<SaveRequest> saves;
+        std::vector<LoadRequest> loads;
+        bool busy = false; // 正在被某个工作线程处理
+
+        int bestPriority() const;
+        bool empty() const { return saves.empty() && loads.empty(); }
+    };
+    struct Completion {
+        std::function<void(bool)> callback;
+        bool result;
+    };
+
+    static uint64_t regionKey(const glm::ivec3& coords);
+    void startWorkerIfNeeded();
+    void workerLoop();
+
+    ChunkStorage* m_storage;
+    QThreadPool m_pool;
+    size_t m_max_pending_loads;
+    size_t m_max_pending_saves;
+
+    QMutex m_mutex; // 保护以下成员
+    std::map<uint64_t, RegionQueue> m_regions;
+    size_t m_pending_loads = 0; // 已提交但尚未执行完的请求数，包括正在执行的
+    size_t m_pending_saves = 0;
+    int m_active_workers = 0;
+    std::vector<Completion> m_completions;
+};
+
+#endif // CHUNKIOSERVICE_H
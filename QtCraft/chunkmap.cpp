@@ -0,0 +1,133 @@
+#include "chunkmap.h"
+
+namespace {
+const size_t INITIAL_CAPACITY = 64;
+}
+
+ChunkMap::ChunkMap()
+{
+    rehash(INITIAL_CAPACITY);
+}
+
+Chunk* ChunkMap::insert(ChunkPtr chunk)
+{
+    uint64_t key = packKey(chunk->coords.x, chunk->coords.z);
+    if (findIndex(key) >= 0) return nullptr;
+
+    // 负载因子保持在 1/2 以下，探测链很短
+    if ((m_chunks.size() + 1) * 2 > m_slots.size()) {
+        rehash(m_slots.size() * 2);
+    }
+
+    Slot& slot = m_slots[findSlot(key)];
+    slot.key = key;
+    slot.index = static_cast<int32_t>(m_chunks.size());
+    m_chunks.push_back(std::move(chunk));
+
+    Chunk* inserted = m_chunks.back().get();
+    linkNeighbors(inserted);
+    return inserted;
+}
+
+ChunkMap::ChunkPtr ChunkMap::remove(int chunk_x, int chunk_z)
+{
+    uint64_t key = packKey(chunk_x, chunk_z);
+    size_t pos = findSlot(key);
+    if (m_slots[pos].index < 0) return nullptr;
+
+    int32_t removed_index = m_slots[pos].index;
+    ChunkPtr removed = std::move(m_chunks[removed_index]);
+    unlinkNeighbors(removed.get());
+    if (m_last_chunk.load(std::memory_order_relaxed) == removed.get()) {
+        m_last_chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // 把最后一个区块挪到空出的位置，保持存储连续
+    int32_t last_index = static_cast<int32_t>(m_chunks.size()) - 1;
+    if (removed_index != last_index) {
+        m_chunks[removed_index] = std::move(m_chunks[last_index]);
+        const glm::ivec3& moved_coords = m_chunks[removed_index]->coords;
+        m_slots[findSlot(packKey(moved_coords.x, moved_coords.z))].index = removed_index;
+    }
+    m_chunks.pop_back();
+
+    // 向后移位删除：把探测链上后续的项往前挪，避免使用墓碑
+    m_slots[pos].index = -1;
+    size_t next = (pos + 1) & m_mask;
+    while (m_slots[next].index >= 0) {
+        size_t ideal = slotFor(m_slots[next].key);
+        // 只有当 ideal 不在 (pos, next] 区间内时，这一项才能挪到 pos
+        if (((next - ideal) & m_mask) >= ((next - pos) & m_mask)) {
+            m_slots[pos] = m_slots[next];
+            m_slots[next].index = -1;
+            pos = next;
+        }
+        next = (next + 1) & m_mask;
+    }
+
+    return removed;
+}
+
+void ChunkMap::clear()
+{
+    m_last_chunk.store(nullptr, std::memory_order_relaxed);
+    for (const ChunkPtr& chunk : m_chunks) {
+        for (Chunk*& neighbor : chunk->neighbors) neighbor = nullptr;
+    }
+    m_chunks.clear();
+    for (Slot& slot : m_slots) slot.index = -1;
+}
+
+int32_t ChunkMap::findIndex(uint64_t key) const
+{
+    size_t pos = slotFor(key);
+    while (m_slots[pos].index >= 0) {
+        if (m_slots[pos].key == key) return m_slots[pos].index;
+        pos = (pos + 1) & m_mask;
+    }
+    return -1;
+}
+
+size_t ChunkMap::findSlot(uint64_t key) const
+{
+    // 返回 key 所在的槽，或者它应该被插入的空槽
+    size_t pos = slotFor(key);
+    while (m_slots[pos].index >= 0 && m_slots[pos].key != key) {
+        pos = (pos + 1) & m_mask;
+    }
+    return pos;
+}
+
+void ChunkMap::rehash(size_t new_capacity)
+{
+    m_slots.assign(new_capacity, Slot());
+    m_mask = new_capacity - 1;
+    m_hash_shift = 64;
+    for (size_t c = new_capacity; c > 1; c >>= 1) --m_hash_shift;
+
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        const glm::ivec3& coords = m_chunks[i]->coords;
+        uint64_t key = packKey(coords.x, coords.z);
+        Slot& slot = m_slots[findSlot(key)];
+        slot.key = key;
+        slot.index = static_cast<int32_t>(i);
+    }
+}
+
+void ChunkMap::linkNeighbors(Chunk* chunk)
+{
+    for (int i = 0; i < NEIGHBOR_COUNT; ++i) {
+        Chunk* neighbor = find(chunk->coords.x + NEIGHBOR_OFFSETS[i][0], chunk->coords.z + NEIGHBOR_OFFSETS[i][1]);
+        chunk->neighbors[i] = neighbor;
+        if (neighbor) neighbor->neighbors[OPPOSITE_NEIGHBOR[i]] = chunk;
+    }
+}
+
+void ChunkMap::unlinkNeighbors(Chunk* chunk)
+{
+    for (int i = 0; i < NEIGHBOR_COUNT; ++i) {
+        Chunk* neighbor = chunk->neighbors[i];
+        if (neighbor) neighbor->neighbors[OPPOSITE_NEIGHBOR[i]] = nullptr;
+        chunk->neighbors[i] = nullptr;
+    }
+}
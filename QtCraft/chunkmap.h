@@ -0,0 +1,77 @@
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+#include "chunkpool.h"
+
+// 区块柱索引
+// 以打包后的 64 位 (x, z) 为键的开放寻址哈希表（线性探测，容量为 2 的幂），
+// 附带一个单项的“上次命中区块”缓存。区块本身按插入顺序连续存放，
+// 遍历顺序稳定，不受哈希顺序影响。插入和移除时同时维护区块之间的邻居链接。
+class ChunkMap {
+public:
+    using ChunkPtr = ChunkPool::Handle;
+    using const_iterator = std::vector<ChunkPtr>::const_iterator;
+
+    ChunkMap();
+
+    static uint64_t packKey(int chunk_x, int chunk_z) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(chunk_x)) << 32) | static_cast<uint32_t>(chunk_z);
+    }
+
+    Chunk* find(int chunk_x, int chunk_z) const {
+        // 连续访问通常落在同一个区块柱内，先检查上次命中的区块
+        Chunk* last = m_last_chunk.load(std::memory_order_relaxed);
+        if (last && last->coords.x == chunk_x && last->coords.z == chunk_z) return last;
+
+        int32_t index = findIndex(packKey(chunk_x, chunk_z));
+        if (index < 0) return nullptr;
+        Chunk* chunk = m_chunks[index].get();
+        m_last_chunk.store(chunk, std::memory_order_relaxed);
+        return chunk;
+    }
+    Chunk* find(const glm::ivec3& chunk_coords) const { return find(chunk_coords.x, chunk_coords.z); }
+
+    // 以 chunk->coords 为键插入，已存在同坐标的区块时返回 nullptr 且不插入
+    Chunk* insert(ChunkPtr chunk);
+    // 移除并返回指定坐标的区块，不存在时返回空指针
+    ChunkPtr remove(int chunk_x, int chunk_z);
+    void clear();
+
+    size_t size() const { return m_chunks.size(); }
+    bool empty() const { return m_chunks.empty(); }
+
+    const_iterator begin() const { return m_chunks.begin(); }
+    const_iterator end() const { return m_chunks.end(); }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        int32_t index = -1; // m_chunks 中的下标，-1 表示空槽
+    };
+
+    size_t slotFor(uint64_t key) const {
+        // Fibonacci 哈希：乘以 2^64 / phi 后取高位
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> m_hash_shift);
+    }
+    int32_t findIndex(uint64_t key) const;
+    size_t findSlot(uint64_t key) const;
+    void rehash(size_t new_capacity);
+    void linkNeighbors(Chunk* chunk);
+    void unlinkNeighbors(Chunk* chunk);
+
+    std::vector<Slot> m_slots;
+    size_t m_mask = 0;
+    int m_hash_shift = 64;
+    std::vector<ChunkPtr> m_chunks;
+    mutable std::atomic<Chunk*> m_last_chunk{nullptr};
+};
+
+#endif // CHUNKMAP_H
@@ -0,0 +1,108 @@
+#include "chunkpool.h"
+
+#include <QDebug>
+#include <cstdlib>
+#include <new>
+
+namespace {
+const size_t PAGE_SIZE = 4096;
+const size_t CACHE_LINE_SIZE = 64;
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+ChunkPool::ChunkPool(size_t chunks_per_slab)
+    : m_chunks_per_slab(chunks_per_slab)
+{
+    // 每个区块占据整数条缓存行，避免相邻区块的热数据共享缓存行
+    static_assert(alignof(Chunk) <= CACHE_LINE_SIZE, "Chunk alignment exceeds cache line size");
+    m_slot_size = roundUp(sizeof(Chunk), CACHE_LINE_SIZE);
+    m_slab_size = roundUp(m_slot_size * m_chunks_per_slab, PAGE_SIZE);
+}
+
+ChunkPool::~ChunkPool()
+{
+    releaseMemory();
+}
+
+ChunkPool::Handle ChunkPool::acquire()
+{
+    if (m_free.empty()) {
+        allocateSlab();
+    }
+    Chunk* chunk = m_free.back();
+    m_free.pop_back();
+    return Handle(chunk, Deleter{this});
+}
+
+void ChunkPool::reserve(size_t chunk_count)
+{
+    while (capacity() < chunk_count) {
+        allocateSlab();
+    }
+}
+
+void ChunkPool::releaseMemory()
+{
+    if (m_free.size() != capacity()) {
+        qWarning() << "ChunkPool: 仍有" << inUse() << "个区块在使用中，无法释放。";
+        return;
+    }
+
+    for (void* slab : m_slabs) {
+        char* base = static_cast<char*>(slab);
+        for (size_t i = 0; i < m_chunks_per_slab; ++i) {
+            reinterpret_cast<Chunk*>(base + i * m_slot_size)->~Chunk();
+        }
+        std::free(slab);
+    }
+    m_slabs.clear();
+    m_free.clear();
+    m_spare_sections.clear();
+    m_spare_sections.shrink_to_fit();
+}
+
+size_t ChunkPool::memoryUsage() const
+{
+    size_t bytes = capacity() * sizeof(Chunk);
+    for (const Chunk* chunk : m_free) {
+        bytes += chunk->blockMemoryUsage() + chunk->lightMemoryUsage();
+    }
+    for (const std::shared_ptr<ChunkSection>& section : m_spare_sections) {
+        bytes += section->memoryUsage();
+    }
+    return bytes;
+}
+
+void ChunkPool::trim()
+{
+    for (Chunk* chunk : m_free) {
+        chunk->releaseSectionMemory();
+    }
+    m_spare_sections.clear();
+}
+
+void ChunkPool::release(Chunk* chunk)
+{
+    chunk->reset(&m_spare_sections);
+    m_free.push_back(chunk);
+}
+
+void ChunkPool::allocateSlab()
+{
+    void* slab = std::aligned_alloc(PAGE_SIZE, m_slab_size);
+    if (!slab) qFatal("区块池 slab 分配失败");
+    m_slabs.push_back(slab);
+    // 备用子区块来自使用中的区块被替换下来的子区块，数量不会超过它们的子区块总数；
+    // 预留好之后 internSections 向备用列表追加时不再扩容
+    m_free.reserve(capacity());
+    m_spare_sections.reserve(capacity() * SECTIONS_PER_CHUNK);
+
+    // 逆序压入空闲列表，使 acquire() 按地址递增的顺序取出区块
+    char* base = static_cast<char*>(slab);
+    for (size_t i = m_chunks_per_slab; i-- > 0;) {
+        m_free.push_back(new (base + i * m_slot_size) Chunk());
+    }
+}
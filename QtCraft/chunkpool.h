@@ -0,0 +1,70 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "chunk.h"
+
+// 区块对象池
+// 区块按页对齐的 slab 成批分配，归还的区块被重置为全空气后放回空闲列表复用，
+// 它的 GL 对象和子区块的缓冲区也一并保留。
+// 区块插入世界时被共享实例替换下来的子区块也留在池中（见 Chunk::internSections），
+// 重置时顶替那些仍被共享、不能原地清空的子区块。预热之后，取出区块并重新生成不再分配内存；
+// 只有子区块的调色板或光照第一次长到比以往都大时才需要扩容。
+// 保留的缓冲区计入内存统计，超出内存预算时由 trim() 归还。
+// 只能在 GUI 线程上使用。
+class ChunkPool {
+public:
+    struct Deleter {
+        ChunkPool* pool = nullptr;
+        void operator()(Chunk* chunk) const { pool->release(chunk); }
+    };
+    using Handle = std::unique_ptr<Chunk, Deleter>;
+
+    explicit ChunkPool(size_t chunks_per_slab = 64);
+    ~ChunkPool();
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // 取出一个已清零的区块
+    Handle acquire();
+
+    // 预留至少 chunk_count 个区块的容量
+    void reserve(size_t chunk_count);
+
+    // 半径为 view_distance 个区块的正方形视距所需的区块数
+    static size_t chunksForViewDistance(int view_distance) {
+        size_t side = static_cast<size_t>(view_distance) * 2 + 1;
+        return side * side;
+    }
+
+    // 析构所有区块并释放 slab，调用时不能有区块仍在使用中。
+    // 区块析构会销毁 GL 对象，需要在 GL 上下文为当前时调用。
+    void releaseMemory();
+
+    size_t capacity() const { return m_slabs.size() * m_chunks_per_slab; }
+    size_t inUse() const { return capacity() - m_free.size(); }
+
+    // 被共享实例替换下来的子区块交给这里，供之后的 reset() 复用
+    std::vector<std::shared_ptr<ChunkSection>>* spareSections() { return &m_spare_sections; }
+    // 区块对象本身，加上空闲区块和备用子区块保留的缓冲区
+    size_t memoryUsage() const;
+    // 释放空闲区块和备用子区块保留的缓冲区，内存紧张时调用；之后的复用需要重新分配
+    void trim();
+
+private:
+    void release(Chunk* chunk);
+    void allocateSlab();
+
+    size_t m_chunks_per_slab;
+    size_t m_slot_size;
+    size_t m_slab_size;
+    std::vector<void*> m_slabs;
+    std::vector<Chunk*> m_free;
+    std::vector<std::shared_ptr<ChunkSection>> m_spare_sections;
+};
+
+#endif // CHUNKPOOL_H
@@ -0,0 +1,52 @@
+#include "chunkscheduler.h"
+#include "chunk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+// 脚下和紧邻的区块无论朝向都按可见处理，物理和碰撞马上就要用到它们
+const float ALWAYS_VISIBLE_RADIUS = 1.5f;
+// 视锥外区块的距离按这个倍数计算，转身之后它们才会排到前面
+const float OFFSCREEN_WEIGHT = 3.0f;
+}
+
+void ChunkScheduler::update(const Camera& camera)
+{
+    m_camera = &camera;
+    m_position = camera.Position / static_cast<float>(CHUNK_SIZE_XZ);
+}
+
+bool ChunkScheduler::isVisible(int chunk_x, int chunk_z) const
+{
+    if (!m_camera) return true;
+    const glm::vec3 min(chunk_x * CHUNK_SIZE_XZ, 0.0f, chunk_z * CHUNK_SIZE_XZ);
+    const glm::vec3 max = min + glm::vec3(CHUNK_SIZE_XZ, WORLD_HEIGHT_IN_BLOCKS, CHUNK_SIZE_XZ);
+    return m_camera->IsBoxInFrustum(min, max);
+}
+
+float ChunkScheduler::priority(int chunk_x, int chunk_z) const
+{
+    const float dx = chunk_x + 0.5f - m_position.x;
+    const float dz = chunk_z + 0.5f - m_position.z;
+    const float distance = std::sqrt(dx * dx + dz * dz);
+    if (distance <= ALWAYS_VISIBLE_RADIUS || isVisible(chunk_x, chunk_z)) return distance;
+    return distance * OFFSCREEN_WEIGHT;
+}
+
+void ChunkScheduler::sortByPriority(std::vector<glm::ivec3>& chunk_coords) const
+{
+    // 先算好每个区块的优先级再排序，视锥测试不在比较函数里重复执行
+    std::vector<std::pair<float, glm::ivec3>> keyed;
+    keyed.reserve(chunk_coords.size());
+    for (const glm::ivec3& coords : chunk_coords) {
+        keyed.emplace_back(priority(coords.x, coords.z), coords);
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const std::pair<float, glm::ivec3>& a, const std::pair<float, glm::ivec3>& b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 0; i < keyed.size(); ++i) {
+        chunk_coords[i] = keyed[i].second;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef CHUNKSCHEDULER_H
+#define CHUNKSCHEDULER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+// 区块任务的调度优先级
+// 生成（含读档）、光照和网格任务都按这里的优先级排序：离摄像机越近越先，
+// 视锥内的区块比视锥外同样距离的区块优先得多。每帧用当前摄像机更新一次，
+// 摄像机移动或转向后，还没开始的任务自动按新的位置和视锥重新排序。
+class ChunkScheduler {
+public:
+    // 视锥取自 Camera::UpdateFrustum 最近一次的结果
+    void update(const Camera& camera);
+
+    // 数值越小越优先
+    float priority(int chunk_x, int chunk_z) const;
+    bool isVisible(int chunk_x, int chunk_z) const;
+
+    // 按优先级升序排列区块坐标
+    void sortByPriority(std::vector<glm::ivec3>& chunk_coords) const;
+
+private:
+    const Camera* m_camera = nullptr;
+    glm::vec3 m_position = glm::vec3(0.0f); // 以区块为单位的摄像机位置，只用 x、z
+};
+
+#endif // CHUNKSCHEDULER_H
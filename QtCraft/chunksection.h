@@ -0,0 +1,38 @@
+#ifndef CHUNKSECTION_H
+#define CHUNKSECTION_H
+
+#include "block.h"
+#include "blockstatestorage.h"
+#include "blockstorage.h"
+#include "lightstorage.h"
+
+// 区块柱按高度切分为 16x16x16 的子区块
+const int SECTION_SIZE = 16;
+const int SECTION_BLOCK_COUNT = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+
+class ChunkSection {
+public:
+    ChunkSection() : blocks(SECTION_BLOCK_COUNT), light(SECTION_BLOCK_COUNT) {}
+
+    // 子区块内局部坐标到存储下标的映射：x 变化最快，其次是 z，最后是 y
+    static int blockIndex(int x, int y, int z) { return (y << 8) | (z << 4) | x; }
+
+    // 整个子区块只有一种方块，且没有任何方块带有状态
+    bool isUniform() const { return blocks.isUniform() && states.empty(); }
+    BlockType uniformBlock() const { return blocks.get(0); }
+    // 整个子区块都是空气
+    bool isEmpty() const { return isUniform() && uniformBlock() == BlockType::Air; }
+
+    // 把方块和光照都尽量压缩为均一存储
+    void compact() { blocks.compact(); light.compact(); }
+    // 释放各存储保留的多余容量
+    void shrinkToFit() { blocks.shrinkToFit(); light.shrinkToFit(); }
+
+    size_t memoryUsage() const { return blocks.memoryUsage() + light.memoryUsage() + states.memoryUsage(); }
+
+    BlockStorage blocks;
+    LightStorage light;
+    BlockStateStorage states; // 大多数子区块为空
+};
+
+#endif // CHUNKSECTION_H
@@ -0,0 +1,217 @@
+#include "chunkserializer.h"
+
+#include <QtEndian>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+// 子区块的写法：完整内容，或者引用本区块中更早写出的同一实例
+const uint8_t SECTION_INLINE = 0;
+const uint8_t SECTION_REFERENCE = 1;
+
+// 头部标志位（版本 2 起）
+const uint8_t FLAG_LIGHT = 0x01;         // 每个子区块带有光照
+const uint8_t FLAG_LIGHT_SETTLED = 0x02; // 光照已经传播完毕
+const uint8_t KNOWN_FLAGS = FLAG_LIGHT | FLAG_LIGHT_SETTLED;
+
+template <typename T>
+void writeValue(QByteArray& out, T value) {
+    value = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// 带边界检查的顺序读取，任何一次越界之后 ok() 都返回 false
+class Reader {
+public:
+    Reader(const char* data, int size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    T read() {
+        T value{};
+        if (!m_ok || m_pos + static_cast<int>(sizeof(T)) > m_size) {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_data + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return qFromLittleEndian(value);
+    }
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos == m_size; }
+
+private:
+    const char* m_data;
+    int m_size;
+    int m_pos = 0;
+    bool m_ok = true;
+};
+
+// 光照按打包字节行程编码：run 数，然后每段 (长度 u16, 打包字节 u8)。
+// 地下和高空的光照大段相同，通常只有几段到几十段
+void writeLight(QByteArray& out, const LightStorage& light) {
+    const std::vector<uint8_t>& data = light.packedData();
+    if (light.isUniform()) {
+        writeValue<uint16_t>(out, 1);
+        writeValue<uint16_t>(out, static_cast<uint16_t>(SECTION_BLOCK_COUNT));
+        writeValue<uint8_t>(out, data[0]);
+        return;
+    }
+
+    const int count_offset = out.size();
+    writeValue<uint16_t>(out, 0);
+    uint16_t run_count = 0;
+    for (int i = 0; i < SECTION_BLOCK_COUNT;) {
+        int end = i + 1;
+        while (end < SECTION_BLOCK_COUNT && data[end] == data[i]) ++end;
+        writeValue<uint16_t>(out, static_cast<uint16_t>(end - i));
+        writeValue<uint8_t>(out, data[i]);
+        ++run_count;
+        i = end;
+    }
+    run_count = qToLittleEndian(run_count);
+    std::memcpy(out.data() + count_offset, &run_count, sizeof(run_count));
+}
+
+bool readLight(Reader& in, LightStorage& light) {
+    const int run_count = in.read<uint16_t>();
+    if (!in.ok() || run_count == 0) return false;
+    if (run_count == 1) {
+        const int length = in.read<uint16_t>();
+        const uint8_t packed = in.read<uint8_t>();
+        if (!in.ok() || length != SECTION_BLOCK_COUNT) return false;
+        light.fill(packed & 0x0F, packed >> 4);
+        return true;
+    }
+
+    std::vector<uint8_t> data;
+    data.reserve(SECTION_BLOCK_COUNT);
+    for (int i = 0; i < run_count; ++i) {
+        const int length = in.read<uint16_t>();
+        const uint8_t packed = in.read<uint8_t>();
+        if (!in.ok() || length == 0 || static_cast<int>(data.size()) + length > SECTION_BLOCK_COUNT) return false;
+        data.insert(data.end(), length, packed);
+    }
+    return light.loadPacked(std::move(data));
+}
+
+void writeSection(QByteArray& out, const ChunkSection& section, bool include_light) {
+    const std::vector<BlockType>& palette = section.blocks.palette();
+    const std::vector<uint64_t>& data = section.blocks.packedData();
+
+    writeValue<uint8_t>(out, static_cast<uint8_t>(section.blocks.bitsPerEntry()));
+    writeValue<uint16_t>(out, static_cast<uint16_t>(palette.size()));
+    for (BlockType type : palette) writeValue<uint8_t>(out, static_cast<uint8_t>(type));
+    writeValue<uint16_t>(out, static_cast<uint16_t>(data.size()));
+    for (uint64_t word : data) writeValue<uint64_t>(out, word);
+
+    writeValue<uint16_t>(out, static_cast<uint16_t>(section.states.size()));
+    for (const BlockStateStorage::Entry& entry : section.states) {
+        writeValue<uint16_t>(out, entry.index);
+        writeValue<uint16_t>(out, entry.state);
+    }
+    if (include_light) writeLight(out, section.light);
+}
+
+bool readSection(Reader& in, ChunkSection& section, bool include_light) {
+    const int bits = in.read<uint8_t>();
+    const int palette_size = in.read<uint16_t>();
+    if (!in.ok() || palette_size > 256) return false;
+    std::vector<BlockType> palette(palette_size);
+    for (BlockType& type : palette) type = static_cast<BlockType>(in.read<uint8_t>());
+
+    const int word_count = in.read<uint16_t>();
+    if (!in.ok() || word_count > SECTION_BLOCK_COUNT) return false;
+    std::vector<uint64_t> data(word_count);
+    for (uint64_t& word : data) word = in.read<uint64_t>();
+    if (!in.ok() || !section.blocks.loadPacked(bits, std::move(palette), std::move(data))) return false;
+
+    const int state_count = in.read<uint16_t>();
+    int previous_index = -1;
+    for (int i = 0; i < state_count; ++i) {
+        const int index = in.read<uint16_t>();
+        const uint16_t state = in.read<uint16_t>();
+        // 状态按下标升序写出，顺序追加不需要移动元素
+        if (!in.ok() || index <= previous_index || index >= SECTION_BLOCK_COUNT) return false;
+        section.states.set(index, state);
+        previous_index = index;
+    }
+    if (include_light && !readLight(in, section.light)) return false;
+    return in.ok();
+}
+}
+
+QByteArray ChunkSerializer::serialize(const Chunk& chunk, Light light)
+{
+    const bool include_light = light != Light::None;
+    uint8_t flags = 0;
+    if (include_light) flags |= FLAG_LIGHT;
+    if (light == Light::Settled) flags |= FLAG_LIGHT_SETTLED;
+
+    QByteArray out;
+    out.reserve(1024);
+    writeValue<uint32_t>(out, FORMAT_VERSION);
+    writeValue<int32_t>(out, chunk.coords.x);
+    writeValue<int32_t>(out, chunk.coords.z);
+    writeValue<uint8_t>(out, flags);
+
+    for (int i = 0; i < SECTIONS_PER_CHUNK; ++i) {
+        int shared_with = -1;
+        for (int j = 0; j < i; ++j) {
+            if (&chunk.section(j) == &chunk.section(i)) {
+                shared_with = j;
+                break;
+            }
+        }
+        if (shared_with >= 0) {
+            writeValue<uint8_t>(out, SECTION_REFERENCE);
+            writeValue<uint8_t>(out, static_cast<uint8_t>(shared_with));
+        } else {
+            writeValue<uint8_t>(out, SECTION_INLINE);
+            writeSection(out, chunk.section(i), include_light);
+        }
+    }
+    return out;
+}
+
+bool ChunkSerializer::deserialize(const QByteArray& data, Chunk& chunk)
+{
+    return deserialize(data.constData(), data.size(), chunk);
+}
+
+bool ChunkSerializer::deserialize(const char* data, int size, Chunk& chunk)
+{
+    Reader in(data, size);
+    const uint32_t version = in.read<uint32_t>();
+    const int32_t x = in.read<int32_t>();
+    const int32_t z = in.read<int32_t>();
+    if (!in.ok() || version == 0 || version > FORMAT_VERSION) return false;
+    if (x != chunk.coords.x || z != chunk.coords.z) return false;
+    const uint8_t flags = version >= 2 ? in.read<uint8_t>() : 0;
+    if (!in.ok() || (flags & ~KNOWN_FLAGS) != 0) return false;
+    const bool include_light = (flags & FLAG_LIGHT) != 0;
+
+    std::shared_ptr<ChunkSection> sections[SECTIONS_PER_CHUNK];
+    for (int i = 0; i < SECTIONS_PER_CHUNK; ++i) {
+        const uint8_t tag = in.read<uint8_t>();
+        if (tag == SECTION_REFERENCE) {
+            const int shared_with = in.read<uint8_t>();
+            if (!in.ok() || shared_with >= i) return false;
+            sections[i] = sections[shared_with];
+        } else if (tag == SECTION_INLINE) {
+            sections[i] = std::make_shared<ChunkSection>();
+            if (!readSection(in, *sections[i], include_light)) return false;
+        } else {
+            return false;
+        }
+    }
+    if (!in.ok() || !in.atEnd()) return false;
+
+    for (int i = 0; i < SECTIONS_PER_CHUNK; ++i) {
+        chunk.setSection(i, std::move(sections[i]));
+    }
+    chunk.rebuildHeightmaps();
+    chunk.is_lit = include_light && (flags & FLAG_LIGHT_SETTLED) != 0;
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef CHUNKSERIALIZER_H
+#define CHUNKSERIALIZER_H
+
+#include <QByteArray>
+#include <cstdint>
+
+#include "chunk.h"
+
+// 区块的二进制编码，用于存档和内存缓存
+// 总是保存方块和方块状态，高度图在加载后重新计算。光照可选：
+// 写出时每个子区块附带行程编码的光照，头部的标志位记录是否带有光照、光照是否已传播完毕，
+// 解码端据此决定是否读取光照，以及是否置位区块的 is_lit。
+// 同一区块内共享同一实例的子区块（例如几个纯空气子区块）只写一次，之后写一个引用。
+// 所有整数都是小端序。版本 1 没有标志位，也从不带光照，仍然可以读取。
+class ChunkSerializer {
+public:
+    static const uint32_t FORMAT_VERSION = 2;
+
+    enum class Light {
+        None,     // 不写光照，加载后重新计算
+        Partial,  // 写出但还没传播完，解码后作为正确的下界，插入时仍需重新计算（内存缓存用）
+        Settled,  // 已经传播完毕，解码后 is_lit 为 true，插入时只需与相邻区块缝合边界
+    };
+
+    static QByteArray serialize(const Chunk& chunk, Light light = Light::None);
+
+    // 数据损坏、坐标不符或版本不支持时返回 false，此时 chunk 的内容不完整，调用者应当 reset()
+    static bool deserialize(const QByteArray& data, Chunk& chunk);
+    // 直接从一段内存解码（例如区域文件的映射内存），不复制输入
+    static bool deserialize(const char* data, int size, Chunk& chunk);
+};
+
+#endif // CHUNKSERIALIZER_H
@@ -0,0 +1,17 @@
+#include "chunksnapshot.h"
+
+ChunkSnapshot::ChunkSnapshot(const Chunk& chunk)
+    : m_coords(chunk.coords)
+{
+    for (int i = 0; i < SECTIONS_PER_CHUNK; ++i) {
+        m_self[i] = chunk.shareSection(i);
+    }
+    for (int n = 0; n < NEIGHBOR_COUNT; ++n) {
+        const Chunk* neighbor = chunk.neighbors[n];
+        if (!neighbor) continue;
+        m_has_neighbor[n] = true;
+        for (int i = 0; i < SECTIONS_PER_CHUNK; ++i) {
+            m_neighbors[n][i] = neighbor->shareSection(i);
+        }
+    }
+}
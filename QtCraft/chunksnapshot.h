@@ -0,0 +1,71 @@
+#ifndef CHUNKSNAPSHOT_H
+#define CHUNKSNAPSHOT_H
+
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+
+// 区块及其四个水平相邻区块在某一时刻的只读快照
+// 构造时只复制子区块的共享引用（写时复制），代价是几十次引用计数递增；
+// 之后主线程对区块的修改都会写到新版本上，快照内容保持不变，可以在任意线程读取。
+// 必须在主线程构造。
+class ChunkSnapshot {
+public:
+    explicit ChunkSnapshot(const Chunk& chunk);
+
+    const glm::ivec3& coords() const { return m_coords; }
+
+    const ChunkSection& section(int index) const { return *m_self[index]; }
+    // 相邻区块未加载时返回 nullptr
+    const ChunkSection* neighborSection(int neighbor, int index) const {
+        return m_has_neighbor[neighbor] ? m_neighbors[neighbor][index].get() : nullptr;
+    }
+
+    BlockType getBlock(int x, int y, int z) const {
+        return section(Chunk::sectionIndex(y)).blocks.get(Chunk::sectionBlockIndex(x, y, z));
+    }
+    uint16_t getBlockState(int x, int y, int z) const {
+        return section(Chunk::sectionIndex(y)).states.get(Chunk::sectionBlockIndex(x, y, z));
+    }
+
+    // 可越界一格的读取，规则与 Chunk::getBlockRelative 相同；
+    // 快照不包含对角方向的区块，x、z 同时越界时视为未加载
+    BlockType getBlockRelative(int x, int y, int z) const {
+        const ChunkSection* s = resolve(x, y, z);
+        return s ? s->blocks.get(Chunk::sectionBlockIndex(x, y, z)) : BlockType::Air;
+    }
+    uint8_t getSkyLightRelative(int x, int y, int z) const {
+        const ChunkSection* s = resolve(x, y, z);
+        return s ? s->light.getSkyLight(Chunk::sectionBlockIndex(x, y, z)) : 0;
+    }
+    uint8_t getBlockLightRelative(int x, int y, int z) const {
+        const ChunkSection* s = resolve(x, y, z);
+        return s ? s->light.getBlockLight(Chunk::sectionBlockIndex(x, y, z)) : 0;
+    }
+
+private:
+    using SectionRef = std::shared_ptr<const ChunkSection>;
+
+    const ChunkSection* resolve(int& x, int y, int& z) const {
+        if (y < 0 || y >= WORLD_HEIGHT_IN_BLOCKS) return nullptr;
+        const int section_index = Chunk::sectionIndex(y);
+        const bool out_x = x < 0 || x >= CHUNK_SIZE_XZ;
+        const bool out_z = z < 0 || z >= CHUNK_SIZE_XZ;
+        if (!out_x && !out_z) return m_self[section_index].get();
+        if (out_x && out_z) return nullptr;
+        if (x < 0) { x += CHUNK_SIZE_XZ; return neighborSection(NEIGHBOR_NEG_X, section_index); }
+        if (x >= CHUNK_SIZE_XZ) { x -= CHUNK_SIZE_XZ; return neighborSection(NEIGHBOR_POS_X, section_index); }
+        if (z < 0) { z += CHUNK_SIZE_XZ; return neighborSection(NEIGHBOR_NEG_Z, section_index); }
+        z -= CHUNK_SIZE_XZ;
+        return neighborSection(NEIGHBOR_POS_Z, section_index);
+    }
+
+    glm::ivec3 m_coords;
+    SectionRef m_self[SECTIONS_PER_CHUNK];
+    SectionRef m_neighbors[NEIGHBOR_COUNT][SECTIONS_PER_CHUNK];
+    bool m_has_neighbor[NEIGHBOR_COUNT] = {false, false, false, false};
+};
+
+#endif // CHUNKSNAPSHOT_H
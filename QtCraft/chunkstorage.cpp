@@ -0,0 +1,108 @@
+#include "chunkstorage.h"
+#include "chunkserializer.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <vector>
+
+ChunkStorage::ChunkStorage(const QString& directory, RegionFile::ReadMode read_mode, bool compress)
+    : m_directory(directory)
+    , m_read_mode(read_mode)
+    , m_compress(compress)
+{
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "无法创建存档目录" << m_directory;
+    }
+}
+
+bool ChunkStorage::loadChunk(Chunk& chunk)
+{
+    RegionFile* file = region(RegionFile::regionCoord(chunk.coords.x), RegionFile::regionCoord(chunk.coords.z), false);
+    if (!file) return false;
+
+    const int local_x = RegionFile::localCoord(chunk.coords.x);
+    const int local_z = RegionFile::localCoord(chunk.coords.z);
+    if (!file->hasChunk(local_x, local_z)) return false;
+
+    const RegionFile::Payload payload = file->read(local_x, local_z);
+    if (!payload.isValid() || !ChunkSerializer::deserialize(payload.data, payload.size, chunk)) {
+        qWarning() << "区块 (" << chunk.coords.x << "," << chunk.coords.z << ") 的存档数据损坏，将重新生成";
+        const glm::ivec3 coords = chunk.coords;
+        chunk.reset();
+        chunk.coords = coords;
+        return false;
+    }
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.chunks_loaded;
+    m_stats.bytes_read += payload.size;
+    return true;
+}
+
+bool ChunkStorage::hasChunk(const glm::ivec3& coords)
+{
+    RegionFile* file = region(RegionFile::regionCoord(coords.x), RegionFile::regionCoord(coords.z), false);
+    return file && file->hasChunk(RegionFile::localCoord(coords.x), RegionFile::localCoord(coords.z));
+}
+
+void ChunkStorage::prefetch(const glm::ivec3& coords)
+{
+    RegionFile* file = region(RegionFile::regionCoord(coords.x), RegionFile::regionCoord(coords.z), false);
+    if (file) file->prefetch(RegionFile::localCoord(coords.x), RegionFile::localCoord(coords.z));
+}
+
+bool ChunkStorage::saveChunk(const Chunk& chunk, bool light_settled)
+{
+    return saveData(chunk.coords, ChunkSerializer::serialize(chunk, light_settled ? ChunkSerializer::Light::Settled
+                                                                                  : ChunkSerializer::Light::None));
+}
+
+bool ChunkStorage::saveData(const glm::ivec3& coords, const QByteArray& data)
+{
+    RegionFile* file = region(RegionFile::regionCoord(coords.x), RegionFile::regionCoord(coords.z), true);
+    if (!file) return false;
+    if (!file->write(RegionFile::localCoord(coords.x), RegionFile::localCoord(coords.z), data, m_compress)) return false;
+
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.chunks_saved;
+    m_stats.bytes_written += data.size();
+    return true;
+}
+
+bool ChunkStorage::sync()
+{
+    // 区域文件打开后就不再关闭，取出指针后在锁外刷盘，不阻塞工作线程打开新的区域
+    std::vector<RegionFile*> files;
+    m_mutex.lock();
+    for (const auto& entry : m_regions) files.push_back(entry.second.get());
+    m_mutex.unlock();
+
+    bool ok = true;
+    for (RegionFile* file : files) ok = file->sync() && ok;
+    return ok;
+}
+
+ChunkStorage::Stats ChunkStorage::stats()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+RegionFile* ChunkStorage::region(int region_x, int region_z, bool create)
+{
+    QMutexLocker locker(&m_mutex);
+    const uint64_t key = regionKey(region_x, region_z);
+    auto it = m_regions.find(key);
+    if (it != m_regions.end()) return it->second.get();
+
+    const QString path = QDir(m_directory).filePath(RegionFile::fileName(region_x, region_z));
+    // 只读取时不创建空文件，未探索过的区域保持没有文件
+    if (!create && !QFile::exists(path)) return nullptr;
+
+    std::unique_ptr<RegionFile> file(new RegionFile(path, m_read_mode));
+    if (!file->open()) return nullptr;
+    RegionFile* result = file.get();
+    m_regions.emplace(key, std::move(file));
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef CHUNKSTORAGE_H
+#define CHUNKSTORAGE_H
+
+#include <QMutex>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "chunk.h"
+#include "regionfile.h"
+
+// 存档目录：按区域坐标打开并缓存 RegionFile，按区块坐标读写单个区块。
+// 内部的锁只保护区域文件表和统计数据；同一个区域文件同一时间只能有一个线程读写，
+// 由 ChunkIOService 按区域分批调度来保证。
+// 默认映射区域文件读取并压缩保存。对于在预先生成好的大世界里快速移动视角、
+// 瓶颈在 IO 的场景，可以关闭压缩：磁盘占用变大，但读取时解码器直接使用映射内存，不再解压。
+// 是否压缩只影响写入，每个区块是否压缩记录在区域文件中，两种区块可以混在同一个存档里读取。
+// 存档是否压缩记录在 world.ini 中（WorldSettings::rawChunks），由预生成工具的 --raw 打开。
+class ChunkStorage {
+public:
+    explicit ChunkStorage(const QString& directory,
+                          RegionFile::ReadMode read_mode = RegionFile::ReadMode::Mapped,
+                          bool compress = true);
+
+    // 从存档中读取 chunk->coords 对应的区块。存档中没有或数据损坏时返回 false，
+    // 数据损坏时 chunk 已被 reset()（保留坐标），调用者直接重新生成即可。
+    bool loadChunk(Chunk& chunk);
+    // 存档中是否保存过 coords 处的区块，不读取数据。与读写一样，不能和同一区域文件上的其它操作同时进行
+    bool hasChunk(const glm::ivec3& coords);
+    // 提示即将读取 coords 处的区块，让磁盘读取与之前的解码重叠。同一区域一批读取前先逐个调用
+    void prefetch(const glm::ivec3& coords);
+    // light_settled 为 true 时光照随方块一起写入，读回的区块插入时不必重新计算光照
+    bool saveChunk(const Chunk& chunk, bool light_settled = false);
+    // 保存已经序列化好的区块数据
+    bool saveData(const glm::ivec3& coords, const QByteArray& data);
+    // 把所有打开的区域文件刷到磁盘，可以在任意线程调用
+    bool sync();
+
+    // 累计的读写统计，用于输出吞吐量
+    struct Stats {
+        int chunks_loaded = 0;
+        int chunks_saved = 0;
+        qint64 bytes_read = 0;    // 解压后的字节数
+        qint64 bytes_written = 0; // 压缩前的字节数
+    };
+    Stats stats();
+
+private:
+    static uint64_t regionKey(int region_x, int region_z) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(region_x)) << 32) | static_cast<uint32_t>(region_z);
+    }
+    // 取得区域文件，文件不存在时 create 决定是否新建；失败返回 nullptr
+    RegionFile* region(int region_x, int region_z, bool create);
+
+    QString m_directory;
+    RegionFile::ReadMode m_read_mode;
+    bool m_compress;
+    QMutex m_mutex;
+    std::unordered_map<uint64_t, std::unique_ptr<RegionFile>> m_regions;
+    Stats m_stats;
+};
+
+#endif // CHUNKSTORAGE_H
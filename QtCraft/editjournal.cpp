@@ -0,0 +1,245 @@
+#include "editjournal.h"
+#include "chunkstorage.h"
+#include "fnv1a.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QStringList>
+#include <QtConcurrent/QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+const uint32_t BATCH_MAGIC = 0x4A454351; // "QCEJ"
+const int BATCH_HEADER_SIZE = 12;        // 魔数 + 记录数 + 校验和
+const int RECORD_SIZE = 14;              // x、y、z 各 4 字节 + 旧方块 + 新方块
+
+void appendInt(QByteArray& out, uint32_t value)
+{
+    value = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char*>(&value), 4);
+}
+
+uint32_t readInt(const char* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, 4);
+    return qFromLittleEndian(value);
+}
+
+// 只用来识别写到一半的批次
+uint32_t checksum(const char* data, int size)
+{
+    return fnv1a32(FNV1A_32_OFFSET_BASIS, data, static_cast<size_t>(size));
+}
+}
+
+EditJournal::EditJournal(const QString& directory, ChunkStorage* storage)
+    : m_directory(directory)
+    , m_storage(storage)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+EditJournal::~EditJournal()
+{
+    commit();
+    m_pool.waitForDone();
+    // 写线程已经空闲，最后在这里重试一次
+    if (!writeUnwritten()) {
+        qWarning() << "退出时仍有" << m_unwritten.size() << "批修改没能写进日志";
+    }
+    if (m_file.isOpen()) m_file.close();
+}
+
+std::vector<EditJournal::Edit> EditJournal::recover()
+{
+    std::vector<Edit> edits;
+    for (int segment : segments()) {
+        if (!readSegment(segmentPath(segment), edits)) {
+            qWarning() << "日志段" << segmentPath(segment) << "的末尾不完整，已丢弃残缺的批次";
+        }
+    }
+    return edits;
+}
+
+int EditJournal::open()
+{
+    const std::vector<int> existing = segments();
+    const int last = existing.empty() ? 0 : existing.back();
+    m_segment = last + 1;
+    return last;
+}
+
+void EditJournal::append(const glm::ivec3& position, BlockType old_type, BlockType new_type)
+{
+    if (m_buffer.isEmpty()) m_buffer.reserve(64 * RECORD_SIZE);
+    appendInt(m_buffer, static_cast<uint32_t>(position.x));
+    appendInt(m_buffer, static_cast<uint32_t>(position.y));
+    appendInt(m_buffer, static_cast<uint32_t>(position.z));
+    m_buffer.append(static_cast<char>(old_type));
+    m_buffer.append(static_cast<char>(new_type));
+    ++m_buffered_edits;
+}
+
+void EditJournal::commit()
+{
+    if (m_buffer.isEmpty()) return;
+
+    QByteArray batch;
+    batch.reserve(BATCH_HEADER_SIZE + m_buffer.size());
+    appendInt(batch, BATCH_MAGIC);
+    appendInt(batch, static_cast<uint32_t>(m_buffered_edits));
+    appendInt(batch, checksum(m_buffer.constData(), m_buffer.size()));
+    batch.append(m_buffer);
+
+    m_stats.edits += m_buffered_edits;
+    ++m_stats.batches;
+    m_stats.bytes_written += batch.size();
+    m_buffer.clear();
+    m_buffered_edits = 0;
+
+    QtConcurrent::run(&m_pool, this, &EditJournal::writeBatch, m_segment, batch);
+}
+
+int EditJournal::beginCheckpoint()
+{
+    commit();
+    return m_segment++;
+}
+
+void EditJournal::completeCheckpoint(int segment)
+{
+    QtConcurrent::run(&m_pool, this, &EditJournal::removeSegments, segment);
+}
+
+void EditJournal::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+QString EditJournal::segmentPath(int segment) const
+{
+    return QDir(m_directory).filePath(QString("edits.%1.journal").arg(segment));
+}
+
+std::vector<int> EditJournal::segments() const
+{
+    std::vector<int> result;
+    const QStringList names = QDir(m_directory).entryList(QStringList() << "edits.*.journal", QDir::Files);
+    for (const QString& name : names) {
+        bool ok = false;
+        const int segment = name.section('.', 1, 1).toInt(&ok);
+        if (ok && segment > 0) result.push_back(segment);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool EditJournal::readSegment(const QString& path, std::vector<Edit>& edits)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray data = file.readAll();
+
+    int offset = 0;
+    while (offset < data.size()) {
+        if (data.size() - offset < BATCH_HEADER_SIZE) return false;
+        const char* header = data.constData() + offset;
+        const uint32_t count = readInt(header + 4);
+        if (readInt(header) != BATCH_MAGIC || count > static_cast<uint32_t>((data.size() - offset) / RECORD_SIZE)) return false;
+        const int size = static_cast<int>(count) * RECORD_SIZE;
+        if (data.size() - offset - BATCH_HEADER_SIZE < size) return false;
+        const char* records = header + BATCH_HEADER_SIZE;
+        if (checksum(records, size) != readInt(header + 8)) return false;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const char* record = records + i * RECORD_SIZE;
+            Edit edit;
+            edit.position = glm::ivec3(static_cast<int32_t>(readInt(record)),
+                                       static_cast<int32_t>(readInt(record + 4)),
+                                       static_cast<int32_t>(readInt(record + 8)));
+            edit.old_type = static_cast<BlockType>(static_cast<uint8_t>(record[12]));
+            edit.new_type = static_cast<BlockType>(static_cast<uint8_t>(record[13]));
+            edits.push_back(edit);
+        }
+        offset += BATCH_HEADER_SIZE + size;
+    }
+    return true;
+}
+
+void EditJournal::writeBatch(int segment, QByteArray batch)
+{
+    // 先排到等待写入的批次后面，保证日志中的顺序与提交顺序一致
+    m_unwritten.emplace_back(segment, std::move(batch));
+    ++m_unwritten_batches;
+    writeUnwritten();
+}
+
+bool EditJournal::writeUnwritten()
+{
+    while (!m_unwritten.empty()) {
+        if (!appendToSegment(m_unwritten.front().first, m_unwritten.front().second)) {
+            ++m_failed_writes;
+            return false;
+        }
+        m_unwritten.pop_front();
+        --m_unwritten_batches;
+    }
+    return true;
+}
+
+bool EditJournal::appendToSegment(int segment, const QByteArray& batch)
+{
+    if (m_file_segment != segment || !m_file.isOpen()) {
+        // 日志段在第一批写入时才创建，没有修改的检查点间隔不会留下空文件
+        if (m_file.isOpen()) m_file.close();
+        m_file.setFileName(segmentPath(segment));
+        m_file_segment = segment;
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "无法打开日志" << m_file.fileName() << m_file.errorString();
+            return false;
+        }
+    }
+
+    const qint64 end = m_file.size();
+    bool ok = m_file.write(batch) == batch.size() && m_file.flush();
+#ifdef Q_OS_UNIX
+    ok = ok && fsync(m_file.handle()) == 0;
+#endif
+    if (!ok) {
+        // 截掉写了一半的批次，否则之后追加的批次在重放时都会被当作残缺数据丢弃。
+        // 批次留在内存中稍后整批重试，不会在日志中出现两次
+        qWarning() << "写入日志失败，稍后重试" << m_file.fileName() << m_file.errorString();
+        m_file.resize(end);
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+void EditJournal::removeSegments(int segment)
+{
+    // 没写进日志的批次只存在于内存中，它所在的日志段以及之后的日志段都不能删除
+    if (!writeUnwritten() && m_unwritten.front().first <= segment) {
+        qWarning() << "有" << m_unwritten.size() << "批修改还没写进日志，保留日志段";
+        return;
+    }
+    // 区域文件没有刷到磁盘之前，日志是断电后恢复这些修改的唯一来源
+    if (m_storage && !m_storage->sync()) {
+        qWarning() << "区域文件刷盘失败，保留日志段";
+        return;
+    }
+    if (m_file.isOpen() && m_file_segment <= segment) m_file.close();
+    for (int existing : segments()) {
+        if (existing > segment) break;
+        if (!QFile::remove(segmentPath(existing))) {
+            qWarning() << "无法删除日志段" << segmentPath(existing);
+        }
+    }
+}
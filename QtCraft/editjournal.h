@@ -0,0 +1,115 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "block.h"
+
+class ChunkStorage;
+
+// 方块修改的预写日志：玩家的每次 setBlock 追加一条记录（世界坐标、旧方块、新方块），
+// 崩溃后在最近一次检查点的存档之上重放，最多丢失最后一次提交之后的修改。
+// - 追加只写进内存缓冲；commit() 把缓冲作为一批交给后台写线程（组提交），
+//   每批写入后 fsync 一次，GUI 线程从不等待磁盘。
+// - 日志分段存放（edits.<编号>.journal）。检查点开始时切换到新的一段，
+//   等旧段中的修改都随区块保存写进区域文件、区域文件刷到磁盘之后，再删除旧段。
+//   因此重放的记录数不超过一个检查点间隔内的修改量。
+// - 每批带有记录数和校验和，写到一半崩溃留下的残缺批次在重放时被丢弃。
+// - 打开、写入或 fsync 失败的批次留在写线程的内存中，按原顺序在下一次提交或检查点时重试；
+//   在它写进日志之前，检查点不删除任何编号不小于它的日志段。
+// 除内部的写线程外，只能在 GUI 线程上使用。
+class EditJournal {
+public:
+    struct Edit {
+        glm::ivec3 position;
+        BlockType old_type;
+        BlockType new_type;
+    };
+
+    // storage 用于在检查点删除日志之前把区域文件刷到磁盘
+    EditJournal(const QString& directory, ChunkStorage* storage);
+    ~EditJournal();
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    // 按写入顺序读出目录中已有的全部记录（上次运行留下的），必须在 open() 之前调用
+    std::vector<Edit> recover();
+    // 开始记录：之后的修改写进一个新的日志段，编号接在已有日志段之后。
+    // 返回已有日志段中最大的编号（没有时为 0），重放完成后用它完成检查点
+    int open();
+
+    void append(const glm::ivec3& position, BlockType old_type, BlockType new_type);
+    bool hasPendingEdits() const { return !m_buffer.isEmpty(); }
+    // 组提交：把缓冲中的修改作为一批交给写线程
+    void commit();
+
+    // 开始检查点：提交缓冲并切换到新的日志段，返回旧日志段的编号。
+    // 此后提交的区块保存全部完成、没有失败时调用 completeCheckpoint
+    int beginCheckpoint();
+    // 先重试没写进日志的批次，再把区域文件刷到磁盘，然后删除编号不超过 segment 的日志段，
+    // 在写线程上执行。仍有属于这些日志段的批次没写进去时保留全部日志段
+    void completeCheckpoint(int segment);
+
+    // 阻塞直到写线程处理完所有已提交的批次
+    void waitForDone();
+
+    // 有批次因为写入失败还留在内存中，可以在任意线程调用
+    bool hasUnwrittenBatches() const { return m_unwritten_batches.load() > 0; }
+
+    struct Stats {
+        int edits = 0;
+        int batches = 0;
+        qint64 bytes_written = 0;
+        int failed_writes = 0;     // 写入日志失败的次数，每次重试失败都计一次
+        int unwritten_batches = 0; // 还没写进日志、等待重试的批次
+    };
+    Stats stats() const {
+        Stats stats = m_stats;
+        stats.failed_writes = m_failed_writes.load();
+        stats.unwritten_batches = m_unwritten_batches.load();
+        return stats;
+    }
+
+private:
+    QString segmentPath(int segment) const;
+    // 目录中已有日志段的编号，从小到大
+    std::vector<int> segments() const;
+    static bool readSegment(const QString& path, std::vector<Edit>& edits);
+
+    // 以下在写线程上执行
+    void writeBatch(int segment, QByteArray batch);
+    // 按顺序写入等待中的批次，遇到失败就停下；全部写入后返回 true
+    bool writeUnwritten();
+    // 把一批追加到日志段并 fsync，失败时截掉写了一半的数据
+    bool appendToSegment(int segment, const QByteArray& batch);
+    void removeSegments(int segment);
+
+    QString m_directory;
+    ChunkStorage* m_storage;
+    QThreadPool m_pool; // 只有一个线程，批次按提交顺序写入
+    int m_segment = 0;  // 当前日志段的编号
+    QByteArray m_buffer;
+    int m_buffered_edits = 0;
+    Stats m_stats;
+
+    // 只在写线程上访问
+    QFile m_file;
+    int m_file_segment = 0;
+    std::deque<std::pair<int, QByteArray>> m_unwritten; // (日志段编号, 批次)，按提交顺序
+
+    std::atomic<int> m_unwritten_batches{0};
+    std::atomic<int> m_failed_writes{0};
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,47 @@
+#ifndef FNV1A_H
+#define FNV1A_H
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a 哈希
+// 区块内容指纹、子区块去重、修改日志的校验和以及预生成工具的世界指纹都用这里的实现。
+// 指纹和校验和会写进日志、在不同机器和版本之间比较，结果不能随平台或版本变化。
+const uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV1A_PRIME = 1099511628211ull;
+
+inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// 把一个 64 位整数按小端序逐字节折叠进 hash，结果与平台的字节序无关
+inline uint64_t fnv1a(uint64_t hash, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// 32 位版本，修改日志的批次校验和只有 32 位
+const uint32_t FNV1A_32_OFFSET_BASIS = 2166136261u;
+const uint32_t FNV1A_32_PRIME = 16777619u;
+
+inline uint32_t fnv1a32(uint32_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_32_PRIME;
+    }
+    return hash;
+}
+
+#endif // FNV1A_H
@@ -0,0 +1,40 @@
+#include "lightstorage.h"
+
+LightStorage::LightStorage(int size)
+    : m_size(size)
+{
+    clear();
+}
+
+void LightStorage::fill(uint8_t sky_light, uint8_t block_light)
+{
+    // 保留逐体素数组的容量，之后再展开时不需要重新分配
+    m_data.assign(1, static_cast<uint8_t>((sky_light & 0x0F) | (block_light << 4)));
+    m_index_mask = 0;
+}
+
+void LightStorage::compact()
+{
+    if (m_index_mask == 0) return;
+    for (int i = 1; i < m_size; ++i) {
+        if (m_data[i] != m_data[0]) return;
+    }
+    uint8_t packed = m_data[0];
+    m_data.assign(1, packed);
+    m_index_mask = 0;
+}
+
+bool LightStorage::loadPacked(std::vector<uint8_t> data)
+{
+    if (data.size() != static_cast<size_t>(m_size)) return false;
+    m_data = std::move(data);
+    m_index_mask = m_size - 1;
+    return true;
+}
+
+void LightStorage::expand()
+{
+    uint8_t packed = m_data[0];
+    m_data.assign(static_cast<size_t>(m_size), packed);
+    m_index_mask = m_size - 1;
+}
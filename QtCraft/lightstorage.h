@@ -0,0 +1,64 @@
+#ifndef LIGHTSTORAGE_H
+#define LIGHTSTORAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 光照等级的最大值，两个通道都使用 0-15
+const uint8_t MAX_LIGHT_LEVEL = 15;
+
+// 半字节打包的双通道光照存储
+// 每个体素一个字节：低 4 位是天空光，高 4 位是方块光。
+// 所有体素光照相同时只保存一个字节（均一存储），第一次写入不同的值时才展开。
+// size 必须是 2 的幂。
+class LightStorage {
+public:
+    explicit LightStorage(int size);
+
+    // 均一存储时 m_index_mask 为 0，所有读取都落在 m_data[0]，无需分支
+    uint8_t getSkyLight(int index) const { return m_data[index & m_index_mask] & 0x0F; }
+    uint8_t getBlockLight(int index) const { return m_data[index & m_index_mask] >> 4; }
+
+    void setSkyLight(int index, uint8_t level) {
+        setPacked(index, static_cast<uint8_t>((m_data[index & m_index_mask] & 0xF0) | (level & 0x0F)));
+    }
+    void setBlockLight(int index, uint8_t level) {
+        setPacked(index, static_cast<uint8_t>((m_data[index & m_index_mask] & 0x0F) | (level << 4)));
+    }
+
+    // 把所有体素设为同一光照，并退化为均一存储。逐体素数组的容量保留下来
+    void fill(uint8_t sky_light, uint8_t block_light);
+    void clear() { fill(0, 0); }
+
+    // 如果所有体素光照相同，则退化为均一存储（同样保留容量）
+    void compact();
+    // 释放逐体素数组多余的容量
+    void shrinkToFit() { m_data.shrink_to_fit(); }
+
+    bool isUniform() const { return m_index_mask == 0; }
+    uint8_t uniformSkyLight() const { return m_data[0] & 0x0F; }
+
+    // 打包后的原始数据（均一存储时只有一个字节），用于去重比较和序列化
+    const std::vector<uint8_t>& packedData() const { return m_data; }
+    // 用逐体素的打包数据整体替换当前内容（反序列化用），长度不符时返回 false 且不修改
+    bool loadPacked(std::vector<uint8_t> data);
+
+    size_t memoryUsage() const { return m_data.capacity(); }
+
+private:
+    void setPacked(int index, uint8_t packed) {
+        if (m_index_mask == 0) {
+            if (packed == m_data[0]) return;
+            expand();
+        }
+        m_data[index] = packed;
+    }
+    void expand();
+
+    int m_size;
+    int m_index_mask = 0;
+    std::vector<uint8_t> m_data;
+};
+
+#endif // LIGHTSTORAGE_H
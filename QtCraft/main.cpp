@@ -1,12 +1,28 @@
 #include "openglwindow.h" // 包含我们自己的头文件
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption seed_option(QStringList() << "s" << "seed", "新建存档时使用的世界种子，已有存档沿用记录的种子。", "n");
+    parser.addOption(seed_option);
+    parser.process(a);
+
     // 创建我们的OpenGL窗口实例
     OpenGLWindow w;
+    if (parser.isSet(seed_option)) {
+        bool ok = false;
+        const int seed = parser.value(seed_option).toInt(&ok);
+        if (!ok) {
+            qWarning() << "无效的种子" << parser.value(seed_option);
+            return 1;
+        }
+        w.setWorldSeed(seed);
+    }
     w.resize(400, 300); // 设置一个初始大小
     w.show();           // 显示窗口
 
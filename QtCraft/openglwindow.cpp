@@ -26,21 +26,33 @@ const float SWIM_VELOCITY = 3.0f;
 const float WATER_MOVE_SPEED_MULTIPLIER = 0.6f;
 const float MAX_SINK_SPEED = -4.0f;
 
-Chunk::Chunk() {
-    // sizeof(blocks) 会自动计算新的数组大小
-    memset(blocks, 0, sizeof(blocks));
-    memset(lighting, 0, sizeof(lighting)); // 初始化光照
-}
-
-Chunk::~Chunk() {
-    if (vbo.isCreated()) vbo.destroy();
-    if (vao.isCreated()) vao.destroy();
-    if (vbo_transparent.isCreated()) vbo_transparent.destroy();
-    if (vao_transparent.isCreated()) vao_transparent.destroy();
-}
+// 以玩家为中心的视距（区块数）
+const int VIEW_DISTANCE_IN_CHUNKS = 12;
+const int UNLOAD_DISTANCE_IN_CHUNKS = VIEW_DISTANCE_IN_CHUNKS + 2;
+// 启动时同步生成、照亮并构建网格的出生区域半径（区块数），与视距无关
+const int SPAWN_RADIUS_IN_CHUNKS = 2;
+const int RAYCAST_MAX_STEPS = 100;
+const char* const WORLD_DIRECTORY = "world";
+const size_t CHUNK_CACHE_BUDGET_BYTES = 64 * 1024 * 1024;
+// 超出内存预算时视距最小缩到这里，每次调整之间至少间隔的时间
+const int MIN_BUDGET_LOAD_RADIUS = 2;
+const qint64 BUDGET_SHRINK_INTERVAL_MS = 250;
+const qint64 BUDGET_GROW_INTERVAL_MS = 2000;
+const qint64 AUTOSAVE_INTERVAL_MS = 60 * 1000;
+// 自动保存排在所有读档和卸载保存之后
+const int AUTOSAVE_IO_PRIORITY = std::numeric_limits<int>::max() / 2;
 
 OpenGLWindow::OpenGLWindow(QWidget *parent)
     : QOpenGLWidget(parent)
+    , m_sky_light(m_chunks)
+    , m_chunk_storage(WORLD_DIRECTORY, RegionFile::ReadMode::Mapped, !WorldSettings::rawChunks(WORLD_DIRECTORY))
+    , m_chunk_io(&m_chunk_storage)
+    , m_chunk_cache(CHUNK_CACHE_BUDGET_BYTES)
+    , m_journal(WORLD_DIRECTORY, &m_chunk_storage)
+    , m_load_radius(VIEW_DISTANCE_IN_CHUNKS)
+    , m_unload_radius(UNLOAD_DISTANCE_IN_CHUNKS)
+    , m_max_load_radius(VIEW_DISTANCE_IN_CHUNKS)
+    , m_unload_margin(UNLOAD_DISTANCE_IN_CHUNKS - VIEW_DISTANCE_IN_CHUNKS)
 {
     setFocusPolicy(Qt::StrongFocus);
     setMouseTracking(true);
@@ -50,12 +62,51 @@ OpenGLWindow::OpenGLWindow(QWidget *parent)
 
     m_elapsed_timer.start();
     m_space_press_timer.start(); // 启动计时器
+    m_budget_timer.start();
+    m_autosave_timer.start();
+    m_startup_timer.start();
 }
 
 OpenGLWindow::~OpenGLWindow()
 {
+    // 后台的生成和网格任务仍在读写区块和本对象的成员，必须先等它们结束
+    QThreadPool::globalInstance()->waitForDone();
+
+    // 保存仍在内存中、有未保存修改的区块；还没插入 m_chunks 的生成结果下次重新生成即可。
+    // 退出时允许阻塞：队列满了就等读写服务清空后再提交。这也是最后一个检查点
+    QElapsedTimer save_timer;
+    save_timer.start();
+    const ChunkStorage::Stats before = m_chunk_storage.stats();
+    m_checkpoint_segment = m_journal.beginCheckpoint();
+    m_checkpoint_failed = false;
+    for (const auto& chunk : m_chunks) {
+        if (!chunk->isDirty()) continue;
+        if (!saveChunk(chunk.get(), 0)) {
+            m_chunk_io.waitForDone();
+            saveChunk(chunk.get(), 0);
+        }
+    }
+    m_chunk_io.waitForDone();
+    // 分发回调才能知道保存是否全部成功；读档失败的回调会启动生成任务，所以再等一次线程池
+    m_chunk_io.dispatchCompletions();
+    QThreadPool::globalInstance()->waitForDone();
+    if (!m_checkpoint_failed && !m_journal_pinned) {
+        m_journal.completeCheckpoint(m_checkpoint_segment);
+    } else {
+        qWarning() << "有区块保存失败，保留修改日志，下次启动时重放";
+    }
+    m_journal.waitForDone();
+    const ChunkStorage::Stats after = m_chunk_storage.stats();
+    const double save_seconds = std::max(save_timer.nsecsElapsed() / 1e9, 1e-9);
+    qDebug() << "区块缓存命中" << m_chunk_cache.hits() << "次，未命中" << m_chunk_cache.misses() << "次，退出时缓存"
+             << m_chunk_cache.size() << "个区块，" << m_chunk_cache.memoryUsage() / 1024 << "KiB。";
+    qDebug() << "保存了" << after.chunks_saved - before.chunks_saved << "个区块，用时" << save_seconds * 1000.0 << "ms，"
+             << (after.bytes_written - before.bytes_written) / (1024.0 * 1024.0) / save_seconds << "MiB/s（未压缩）。";
+
     makeCurrent();
+    m_generating_chunks.clear();
     m_chunks.clear();
+    m_chunk_pool.releaseMemory();
     delete m_texture_atlas;
     delete m_hotbar_texture;
     delete m_hotbar_selector_texture;
@@ -314,13 +365,12 @@ void OpenGLWindow::initOverlay() {
 }
 
 int OpenGLWindow::findSafeSpawnY(int x, int z) {
-    for (int y = WORLD_HEIGHT_IN_BLOCKS - 1; y >= 0; --y) {
-        BlockType block_type = static_cast<BlockType>(getBlock({x, y, z}));
-        if (block_type != BlockType::Air && block_type != BlockType::Water) {
-            return y + 1;
-        }
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock({x, 0, z}, local_pos);
+    if (!chunk || chunk->opaqueHeight(local_pos.x, local_pos.z) == 0) {
+        return WORLD_HEIGHT_IN_BLOCKS; // 如果没有找到地面，则在世界顶部出生
     }
-    return WORLD_HEIGHT_IN_BLOCKS; // 如果没有找到地面，则在世界顶部出生
+    return chunk->opaqueHeight(local_pos.x, local_pos.z);
 }
 
 void OpenGLWindow::initializeGL()
@@ -331,9 +381,11 @@ void OpenGLWindow::initializeGL()
     initCrosshair();
     initInventoryBar();
     initOverlay();
-    generateWorld();
-
-    initializeSunlight();
+    // 种子在任何区块生成之前确定，日志重放也可能需要重新生成区块
+    m_terrain.setSeed(WorldSettings::resolveSeed(WORLD_DIRECTORY, m_has_requested_seed, m_requested_seed));
+    qDebug() << "世界种子" << m_terrain.seed();
+    recoverEditJournal();
+    generateSpawnArea();
     m_camera.Position.y = findSafeSpawnY(m_camera.Position.x, m_camera.Position.z);
 
     glClearColor(0.39f, 0.58f, 0.93f, 1.0f);
@@ -341,127 +393,505 @@ void OpenGLWindow::initializeGL()
     glEnable(GL_CULL_FACE);
 }
 
-void OpenGLWindow::generateChunk(Chunk* chunk, const glm::ivec3& chunk_coords)
+
+
+void OpenGLWindow::generateSpawnArea() {
+    // 只有出生点周围的少量区块同步准备：读档或生成、把光照传播完、构建并上传网格，
+    // 第一帧就能画出完整的地面。视距内其余的区块由流式加载在之后的帧里补上，
+    // 因此首帧耗时与视距无关。对象池也只预留出生区域，之后按 slab 增长
+    m_chunk_pool.reserve(ChunkPool::chunksForViewDistance(SPAWN_RADIUS_IN_CHUNKS));
+    const glm::ivec3 center = worldToChunkCoords(glm::ivec3(glm::floor(m_camera.Position)));
+
+    // 分别统计读档和生成的耗时，读档应当明显快于生成
+    int loaded_count = 0, generated_count = 0;
+    qint64 load_nsecs = 0, generate_nsecs = 0;
+    QElapsedTimer chunk_timer;
+    // 由近到远插入，出生点附近的光照最先传播
+    std::vector<glm::ivec3> spawn_chunks;
+    const int spawn_radius = std::min(SPAWN_RADIUS_IN_CHUNKS, m_load_radius);
+    for (int x = center.x - spawn_radius; x <= center.x + spawn_radius; ++x) {
+        for (int z = center.z - spawn_radius; z <= center.z + spawn_radius; ++z) {
+            // y坐标设为0，代表区块柱
+            spawn_chunks.push_back(glm::ivec3(x, 0, z));
+        }
+    }
+    // 第一帧还没有画过，先按窗口尺寸算出视锥，调度器的视锥判断才有意义
+    updateCameraFrustum();
+    m_scheduler.update(m_camera);
+    m_scheduler.sortByPriority(spawn_chunks);
+    for (const glm::ivec3& coords : spawn_chunks) {
+        auto new_chunk = m_chunk_pool.acquire();
+        new_chunk->coords = coords;
+        chunk_timer.start();
+        if (loadOrGenerateChunk(new_chunk.get())) {
+            ++loaded_count;
+            load_nsecs += chunk_timer.nsecsElapsed();
+        } else {
+            ++generated_count;
+            generate_nsecs += chunk_timer.nsecsElapsed();
+        }
+        addChunk(std::move(new_chunk));
+    }
+    const qint64 chunks_nsecs = m_startup_timer.nsecsElapsed();
+
+    // 光照传播到未加载的区块就停下，工作量只取决于出生区域的大小
+    const size_t light_nodes = m_sky_light.pendingNodes();
+    m_sky_light.propagate();
+    m_light_settled_sequence = m_insert_sequence;
+    const qint64 light_nsecs = m_startup_timer.nsecsElapsed();
+
+    // 网格并行构建，等全部完成后在这里上传（initializeGL 中 GL 上下文为当前）。
+    // 边缘区块的网格在相邻区块流式加载进来后会被重新构建
+    for (const glm::ivec3& coords : spawn_chunks) {
+        dispatchChunkMesh(m_chunks.find(coords));
+    }
+    QThreadPool::globalInstance()->waitForDone();
+    std::vector<ChunkMesh> spawn_meshes;
+    m_ready_meshes_mutex.lock();
+    spawn_meshes.swap(m_ready_meshes);
+    m_ready_meshes_mutex.unlock();
+    for (const ChunkMesh& mesh : spawn_meshes) {
+        Chunk* chunk = currentMeshTarget(mesh);
+        if (!chunk) continue;
+        uploadChunkMesh(chunk, mesh.opaque, mesh.transparent);
+        chunk->is_building = false;
+    }
+    const qint64 mesh_nsecs = m_startup_timer.nsecsElapsed();
+
+    qDebug() << "出生区域" << m_chunks.size() << "个区块：读档/生成完成于" << chunks_nsecs / 1000000 << "ms，"
+             << light_nodes << "个天空光节点传播完成于" << light_nsecs / 1000000 << "ms，"
+             << "网格上传完成于" << mesh_nsecs / 1000000 << "ms（从窗口创建开始计时）。";
+    qDebug() << "读档" << loaded_count << "个区块，平均" << (loaded_count ? load_nsecs / loaded_count / 1000 : 0) << "us/个；"
+             << "生成" << generated_count << "个区块，平均" << (generated_count ? generate_nsecs / generated_count / 1000 : 0) << "us/个。";
+    if (loaded_count > 0) {
+        const ChunkStorage::Stats stats = m_chunk_storage.stats();
+        qDebug() << "读档吞吐量" << stats.bytes_read / (1024.0 * 1024.0) / std::max(load_nsecs / 1e9, 1e-9) << "MiB/s（解压后）。";
+    }
+
+    size_t block_bytes = 0;
+    int uniform_sections = 0;
+    for (const auto& chunk : m_chunks) {
+        block_bytes += chunk->blockMemoryUsage();
+        for (int s = 0; s < SECTIONS_PER_CHUNK; ++s) {
+            if (chunk->section(s).isUniform()) ++uniform_sections;
+        }
+    }
+    qDebug() << "方块数据占用" << block_bytes / 1024 << "KiB，稠密数组需要"
+             << m_chunks.size() * Chunk::BLOCK_COUNT / 1024 << "KiB；"
+             << uniform_sections << "/" << m_chunks.size() * SECTIONS_PER_CHUNK << "个子区块为均一子区块。";
+    qDebug() << "子区块去重：" << m_chunks.size() * SECTIONS_PER_CHUNK << "个引用共享"
+             << m_section_store.liveCount() << "个实例，占用" << m_section_store.liveMemoryUsage() / 1024 << "KiB。";
+}
+
+void OpenGLWindow::setStreamingRadii(int load_radius, int unload_radius)
 {
-    FastNoiseLite noise;
-    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    m_load_radius = std::max(load_radius, 0);
+    m_unload_radius = std::max(unload_radius, m_load_radius + 1);
+    m_max_load_radius = m_load_radius;
+    m_unload_margin = m_unload_radius - m_load_radius;
+}
 
-    FastNoiseLite distortion_noise;
-    distortion_noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-    distortion_noise.SetFrequency(0.05f);
+void OpenGLWindow::setWorldSeed(int seed)
+{
+    m_has_requested_seed = true;
+    m_requested_seed = seed;
+}
 
-    int octaves = 5;
-    float persistence = 0.5f;
-    float lacunarity = 2.2f;
-    float base_frequency = 0.1f;
-    float base_amplitude = 20.0f;
-    float distortion_strength = 10.0f;
+void OpenGLWindow::setMemoryBudget(size_t bytes)
+{
+    m_memory_budget = bytes;
+    if (bytes == 0) m_chunk_cache.setByteBudget(CHUNK_CACHE_BUDGET_BYTES);
+}
 
-    for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
-        for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
-            int world_x = chunk_coords.x * CHUNK_SIZE_XZ + x;
-            int world_z = chunk_coords.z * CHUNK_SIZE_XZ + z;
-
-            float distortion_x = distortion_noise.GetNoise((float)world_x, (float)world_z) * distortion_strength;
-            float distortion_z = distortion_noise.GetNoise((float)world_x + 543.21f, (float)world_z - 123.45f) * distortion_strength;
-
-            float total_noise = 0.0f;
-            float frequency = base_frequency;
-            float amplitude = base_amplitude;
-
-            for (int i = 0; i < octaves; ++i) {
-                total_noise += noise.GetNoise(
-                                   (float)world_x * frequency + distortion_x,
-                                   (float)world_z * frequency + distortion_z
-                                   ) * amplitude;
-                amplitude *= persistence;
-                frequency *= lacunarity;
-            }
-            int sea_level = 8;
-            int terrain_height = static_cast<int>(total_noise) + sea_level;
+OpenGLWindow::MemoryStats OpenGLWindow::memoryStats()
+{
+    MemoryStats stats;
+    for (const auto& chunk : m_chunks) {
+        // 共享的子区块会被重复计入，偏保守；实际被共享的大多是只占几个字节的均一子区块
+        stats.block_bytes += chunk->blockMemoryUsage();
+        stats.light_bytes += chunk->lightMemoryUsage();
+        stats.mesh_gpu_bytes += static_cast<size_t>(chunk->vertex_count + chunk->vertex_count_transparent) * sizeof(Vertex);
+    }
+    m_ready_meshes_mutex.lock();
+    for (const ChunkMesh& mesh : m_ready_meshes) {
+        stats.mesh_cpu_bytes += (mesh.opaque.capacity() + mesh.transparent.capacity()) * sizeof(Vertex);
+    }
+    m_ready_meshes_mutex.unlock();
+    stats.cache_bytes = m_chunk_cache.memoryUsage();
+    stats.chunk_bytes = m_chunk_pool.memoryUsage();
+    stats.budget = m_memory_budget;
+    stats.loaded_chunks = static_cast<int>(m_chunks.size());
+    stats.cached_chunks = static_cast<int>(m_chunk_cache.size());
+    stats.load_radius = m_load_radius;
+    return stats;
+}
 
-            // 遍历整个区块高度
-            for (int y = 0; y < WORLD_HEIGHT_IN_BLOCKS; ++y) {
-                int world_y = y; // 世界y坐标就是区块内的y坐标
+void OpenGLWindow::enforceMemoryBudget()
+{
+    if (m_memory_budget == 0) return;
+    MemoryStats stats = memoryStats();
+    if (stats.total() - stats.cache_bytes > m_memory_budget) {
+        // 先归还对象池中空闲区块保留的缓冲区，还不够再缩小视距
+        m_chunk_pool.trim();
+        stats = memoryStats();
+    }
+    const size_t live_bytes = stats.total() - stats.cache_bytes;
+
+    // 压缩缓存只用活动区块剩下的预算，缓存中的区块都已提交保存，丢弃不会丢数据
+    const size_t cache_budget = live_bytes < m_memory_budget ? m_memory_budget - live_bytes : 0;
+    m_chunk_cache.setByteBudget(std::min(cache_budget, CHUNK_CACHE_BUDGET_BYTES));
+
+    // 活动区块本身超出预算时缩小视距，下一步的卸载会把最远的区块移出（进入压缩缓存或直接丢弃）；
+    // 回落到 80% 以下后再一圈一圈地恢复
+    const qint64 since_last_change = m_budget_timer.elapsed();
+    if (live_bytes > m_memory_budget) {
+        if (m_load_radius > MIN_BUDGET_LOAD_RADIUS && since_last_change >= BUDGET_SHRINK_INTERVAL_MS) {
+            --m_load_radius;
+            m_unload_radius = m_load_radius + m_unload_margin;
+            m_budget_timer.restart();
+            qDebug() << "内存用量" << live_bytes / (1024 * 1024) << "MiB 超出预算" << m_memory_budget / (1024 * 1024)
+                     << "MiB，视距缩小到" << m_load_radius;
+        }
+    } else if (live_bytes < m_memory_budget / 5 * 4 && m_load_radius < m_max_load_radius &&
+               since_last_change >= BUDGET_GROW_INTERVAL_MS) {
+        ++m_load_radius;
+        m_unload_radius = m_load_radius + m_unload_margin;
+        m_budget_timer.restart();
+    }
+}
 
-                BlockType blockToPlace = BlockType::Air;
-                if (world_y > terrain_height) {
-                    if (world_y <= sea_level) {
-                        blockToPlace = BlockType::Water;
-                    }
-                } else {
-                    if (world_y == terrain_height && world_y > sea_level) {
-                        blockToPlace = BlockType::Grass;
-                    } else if (world_y > terrain_height - 5) {
-                        blockToPlace = BlockType::Dirt;
-                    } else {
-                        blockToPlace = BlockType::Stone;
-                    }
-                }
-                // 注意数组索引顺序
-                chunk->blocks[x][y][z] = static_cast<uint8_t>(blockToPlace);
+Chunk* OpenGLWindow::addChunk(ChunkMap::ChunkPtr chunk)
+{
+    Chunk* inserted = m_chunks.insert(std::move(chunk));
+    if (!inserted) return nullptr;
+
+    // 插入时计算的光照不推进修改代数（见 SkyLight）：边界缝合、清除过期的边界光照，
+    // 以及之后几帧里分批传播到本区块和相邻区块的光照，都不会让它们变脏，
+    // 即使光照因此真的改变了——下次插入时会重新缝合出同样的结果。
+    // 因此不带光照恢复的区块（旧版本存档）不会只为了写入光照而保存，每次插入都重新计算
+    inserted->insert_sequence = ++m_insert_sequence;
+    m_sky_light.initializeChunk(inserted);
+    // 在天空光填充之后去重，此时地下和高空的子区块连同光照一起都是均一的；
+    // 之后的光照传播只会复制真正被写到的那些子区块
+    inserted->internSections(m_section_store, m_chunk_pool.spareSections());
+
+    // 相邻区块原来把这一侧当作空气绘制了边界面，需要重建
+    for (Chunk* neighbor : inserted->neighbors) {
+        if (neighbor) neighbor->needs_remeshing = true;
+    }
+    return inserted;
+}
+
+bool OpenGLWindow::loadOrGenerateChunk(Chunk* chunk)
+{
+    if (m_chunk_storage.loadChunk(*chunk)) return true;
+    m_terrain.generate(*chunk);
+    return false;
+}
+
+void OpenGLWindow::generateChunkAsync(Chunk* chunk)
+{
+    // 区块在生成完成之前不在 m_chunks 中，其它线程看不到它
+    m_terrain.generate(*chunk);
+
+    m_generated_chunks_mutex.lock();
+    m_generated_chunks.push_back(ChunkMap::packKey(chunk->coords.x, chunk->coords.z));
+    m_generated_chunks_mutex.unlock();
+}
+
+void OpenGLWindow::decodeCachedChunkAsync(Chunk* chunk, ChunkCache::Entry entry)
+{
+    if (!ChunkCache::decode(entry, *chunk)) {
+        // 缓存数据是本进程编码的，解码失败说明有 bug；退回生成，不影响存档
+        qWarning() << "区块 (" << chunk->coords.x << "," << chunk->coords.z << ") 的缓存数据无法解码，重新生成";
+        const glm::ivec3 coords = chunk->coords;
+        chunk->reset();
+        chunk->coords = coords;
+        m_terrain.generate(*chunk);
+    }
+
+    m_generated_chunks_mutex.lock();
+    m_generated_chunks.push_back(ChunkMap::packKey(chunk->coords.x, chunk->coords.z));
+    m_generated_chunks_mutex.unlock();
+}
+
+void OpenGLWindow::updateChunkStreaming()
+{
+    const glm::ivec3 center = worldToChunkCoords(glm::ivec3(glm::floor(m_camera.Position)));
+
+    // 1. 接收读档或后台生成完成的区块。读写服务的回调在这里执行：
+    //    读到存档的区块直接进入接收列表，存档中没有的区块转交生成任务
+    m_chunk_io.dispatchCompletions();
+    std::vector<uint64_t> generated;
+    m_generated_chunks_mutex.lock();
+    generated.swap(m_generated_chunks);
+    m_generated_chunks_mutex.unlock();
+    std::vector<glm::ivec3> arrived;
+    for (uint64_t key : generated) {
+        auto it = m_generating_chunks.find(key);
+        if (it == m_generating_chunks.end()) continue;
+        const glm::ivec3 coords = it->second->coords;
+        // 读档或生成期间玩家已经走远的区块直接丢弃
+        if (std::max(std::abs(coords.x - center.x), std::abs(coords.z - center.z)) > m_unload_radius) {
+            m_generating_chunks.erase(it);
+            continue;
+        }
+        arrived.push_back(coords);
+    }
+    // 按优先级插入：天空光按插入顺序入队，光照传播也就先处理近处和视锥内的区块
+    m_scheduler.sortByPriority(arrived);
+    for (const glm::ivec3& coords : arrived) {
+        auto it = m_generating_chunks.find(ChunkMap::packKey(coords.x, coords.z));
+        ChunkMap::ChunkPtr chunk = std::move(it->second);
+        m_generating_chunks.erase(it);
+        addChunk(std::move(chunk));
+    }
+
+    // 2. 卸载超出卸载半径的区块，先收集坐标，移除会改变 m_chunks 的遍历顺序。
+    //    超出内存预算时卸载半径先被缩小
+    enforceMemoryBudget();
+    std::vector<glm::ivec3> far_chunks;
+    for (const auto& chunk : m_chunks) {
+        const glm::ivec3& coords = chunk->coords;
+        if (std::max(std::abs(coords.x - center.x), std::abs(coords.z - center.z)) > m_unload_radius) {
+            far_chunks.push_back(coords);
+        }
+    }
+    if (!far_chunks.empty()) {
+        makeCurrent();
+        for (const glm::ivec3& coords : far_chunks) {
+            // 保存队列已满时先不卸载，下一帧再试，数据不会丢失
+            const int distance = std::max(std::abs(coords.x - center.x), std::abs(coords.z - center.z));
+            Chunk* far_chunk = m_chunks.find(coords.x, coords.z);
+            if (far_chunk->isDirty() && !saveChunk(far_chunk, distance)) break;
+            const bool light_settled = isLightSettled(far_chunk);
+            ChunkMap::ChunkPtr chunk = m_chunks.remove(coords.x, coords.z);
+            m_chunk_cache.put(*chunk, light_settled);
+            releaseChunkMesh(chunk.get());
+        }
+        doneCurrent();
+    }
+
+    // 3. 按调度优先级派发缺失区块：先查内存缓存，再交给读写服务读档，存档中没有才生成。
+    //    同时在途的区块数受限，避免占满线程池、拖慢网格构建；没派发的下一帧重新排序
+    const size_t max_pending = static_cast<size_t>(std::max(QThread::idealThreadCount(), 1)) * 2;
+    if (m_generating_chunks.size() >= max_pending) return;
+
+    std::vector<glm::ivec3> missing;
+    for (int x = center.x - m_load_radius; x <= center.x + m_load_radius; ++x) {
+        for (int z = center.z - m_load_radius; z <= center.z + m_load_radius; ++z) {
+            if (m_chunks.find(x, z) || m_generating_chunks.count(ChunkMap::packKey(x, z))) continue;
+            missing.push_back(glm::ivec3(x, 0, z));
+        }
+    }
+    m_scheduler.sortByPriority(missing);
+    if (missing.empty() && m_generating_chunks.empty() && !m_view_filled_reported) {
+        m_view_filled_reported = true;
+        qDebug() << "视距内的" << m_chunks.size() << "个区块全部加载完成，距窗口创建" << m_startup_timer.elapsed() << "ms。";
+    }
+
+    for (const glm::ivec3& coords : missing) {
+        if (m_generating_chunks.size() >= max_pending) break;
+        const uint64_t key = ChunkMap::packKey(coords.x, coords.z);
+
+        auto new_chunk = m_chunk_pool.acquire();
+        new_chunk->coords = coords;
+        Chunk* chunk = new_chunk.get();
+        ChunkCache::Entry cached = m_chunk_cache.take(coords.x, coords.z);
+        if (cached.isValid()) {
+            m_generating_chunks.emplace(key, std::move(new_chunk));
+            QtConcurrent::run(this, &OpenGLWindow::decodeCachedChunkAsync, chunk, cached);
+            continue;
+        }
+        const int io_priority = static_cast<int>(m_scheduler.priority(coords.x, coords.z) * 16.0f);
+        const bool queued = m_chunk_io.load(chunk, io_priority, [this, chunk, key](bool loaded) {
+            if (loaded) {
+                m_generated_chunks_mutex.lock();
+                m_generated_chunks.push_back(key);
+                m_generated_chunks_mutex.unlock();
+            } else {
+                QtConcurrent::run(this, &OpenGLWindow::generateChunkAsync, chunk);
             }
+        });
+        // 读取队列已满，剩下的下一帧再派发；未用的区块随 new_chunk 归还对象池
+        if (!queued) break;
+        m_generating_chunks.emplace(key, std::move(new_chunk));
+    }
+}
+
+bool OpenGLWindow::saveChunk(Chunk* chunk, int priority)
+{
+    // 数据在提交时就已序列化，之后的修改会让区块重新变脏
+    const uint32_t generation = chunk->generation();
+    const glm::ivec3 coords = chunk->coords;
+    const uint64_t ticket = ++m_save_ticket;
+    // 光照还在传播时只保存方块，读回后重新计算光照
+    const bool queued = m_chunk_io.save(*chunk, priority, isLightSettled(chunk), [this, coords, ticket](bool saved) {
+        m_saves_in_flight.erase(ticket);
+        if (saved) return;
+        qWarning() << "区块 (" << coords.x << "," << coords.z << ") 保存失败";
+        if (Chunk* chunk = m_chunks.find(coords)) {
+            // 还在内存中就重新标记为脏，下次自动保存或卸载时重试；在那之前日志段不能删除
+            chunk->markDirty();
+            if (m_checkpoint_segment >= 0) m_checkpoint_failed = true;
+        } else {
+            m_journal_pinned = true;
         }
+    });
+    if (queued) {
+        chunk->markSaved(generation);
+        m_saves_in_flight.insert(ticket);
     }
+    return queued;
 }
 
+void OpenGLWindow::runAutosave()
+{
+    if (!m_autosave_running) {
+        // 上一个检查点完成之前不开始新的一轮
+        if (m_checkpoint_segment >= 0 && !completeCheckpoint()) return;
+        if (m_autosave_timer.elapsed() < AUTOSAVE_INTERVAL_MS) return;
+        m_autosave_timer.restart();
+        m_autosave_running = true;
+        m_autosave_written = 0;
+        // 之后的修改写进新的日志段，旧日志段中的修改都包含在本轮及之前提交的保存里
+        m_checkpoint_segment = m_journal.beginCheckpoint();
+        m_checkpoint_failed = false;
+    }
 
-void OpenGLWindow::generateWorld() {
-    int world_size_in_chunks = 24;
+    // 只写有未保存修改的区块，开销与修改量成正比；扫描脏标记本身只是遍历已加载的区块。
+    // 按区域文件和区域内的下标排序，写入顺序确定，同一区域的写入也能合并成一批
+    std::vector<Chunk*> dirty_chunks;
+    for (const auto& chunk : m_chunks) {
+        if (chunk->isDirty()) dirty_chunks.push_back(chunk.get());
+    }
+    std::sort(dirty_chunks.begin(), dirty_chunks.end(), [](const Chunk* a, const Chunk* b) {
+        const int a_rx = RegionFile::regionCoord(a->coords.x), a_rz = RegionFile::regionCoord(a->coords.z);
+        const int b_rx = RegionFile::regionCoord(b->coords.x), b_rz = RegionFile::regionCoord(b->coords.z);
+        if (a_rx != b_rx) return a_rx < b_rx;
+        if (a_rz != b_rz) return a_rz < b_rz;
+        if (a->coords.z != b->coords.z) return a->coords.z < b->coords.z;
+        return a->coords.x < b->coords.x;
+    });
+
+    for (Chunk* chunk : dirty_chunks) {
+        // 保存队列已满，剩下的下一帧继续
+        if (!saveChunk(chunk, AUTOSAVE_IO_PRIORITY)) return;
+        ++m_autosave_written;
+    }
+    m_autosave_running = false;
+    m_checkpoint_barrier = m_save_ticket;
+    qDebug() << "自动保存：写入" << m_autosave_written << "/" << m_chunks.size() << "个已加载区块。";
+}
 
-    for (int x = -world_size_in_chunks / 2; x < world_size_in_chunks / 2; ++x) {
-        for (int z = -world_size_in_chunks / 2; z < world_size_in_chunks / 2; ++z) {
-            // y坐标设为0，代表区块柱
-            glm::ivec3 chunk_coords(x, 0, z);
-            auto new_chunk = std::make_unique<Chunk>();
-            new_chunk->coords = chunk_coords;
-            generateChunk(new_chunk.get(), chunk_coords);
-            m_chunks[chunk_coords] = std::move(new_chunk);
+bool OpenGLWindow::completeCheckpoint()
+{
+    if (!m_saves_in_flight.empty() && *m_saves_in_flight.begin() <= m_checkpoint_barrier) return false;
+
+    if (!m_checkpoint_failed && !m_journal_pinned) {
+        m_journal.completeCheckpoint(m_checkpoint_segment);
+    } else {
+        qWarning() << "有区块保存失败，保留修改日志";
+    }
+    m_checkpoint_segment = -1;
+    return true;
+}
+
+void OpenGLWindow::recoverEditJournal()
+{
+    // 日志中是上次运行最后一个检查点之后的修改，正常退出时为空。
+    // 按区块分组，每个区块读档（或重新生成）一次，按原顺序重放后同步写回存档
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<EditJournal::Edit> edits = m_journal.recover();
+    const int last_segment = m_journal.open();
+    if (edits.empty()) {
+        if (last_segment > 0) m_journal.completeCheckpoint(last_segment);
+        return;
+    }
+
+    std::map<uint64_t, std::vector<const EditJournal::Edit*>> edits_by_chunk;
+    for (const EditJournal::Edit& edit : edits) {
+        if (edit.position.y < 0 || edit.position.y >= WORLD_HEIGHT_IN_BLOCKS) continue;
+        if (static_cast<int>(edit.new_type) >= BLOCK_TYPE_COUNT) continue;
+        const uint64_t key = ChunkMap::packKey(blockToChunk(edit.position.x), blockToChunk(edit.position.z));
+        edits_by_chunk[key].push_back(&edit);
+    }
+
+    int mismatched = 0;
+    bool saved_all = true;
+    for (const auto& entry : edits_by_chunk) {
+        const glm::ivec3& first = entry.second.front()->position;
+        auto chunk = m_chunk_pool.acquire();
+        chunk->coords = glm::ivec3(blockToChunk(first.x), 0, blockToChunk(first.z));
+        loadOrGenerateChunk(chunk.get());
+        for (const EditJournal::Edit* edit : entry.second) {
+            const int x = blockToLocal(edit->position.x);
+            const int z = blockToLocal(edit->position.z);
+            // 存档可能已经包含了其中一部分修改，按顺序重放到最后一条，结果与崩溃前相同
+            const BlockType current = chunk->getBlock(x, edit->position.y, z);
+            if (current != edit->old_type && current != edit->new_type) ++mismatched;
+            chunk->setBlock(x, edit->position.y, z, edit->new_type);
         }
+        if (!m_chunk_storage.saveChunk(*chunk)) saved_all = false;
     }
-    qDebug() << "生成了" << m_chunks.size() << "个区块。";
 
-    for(auto const& [coords, chunk] : m_chunks){
-        chunk->needs_remeshing = true;
+    qDebug() << "从修改日志重放了" << edits.size() << "次修改，涉及" << edits_by_chunk.size() << "个区块，用时"
+             << timer.elapsed() << "ms。";
+    if (mismatched > 0) qWarning() << mismatched << "次修改的旧方块与存档不一致，以日志为准";
+    if (saved_all) {
+        m_journal.completeCheckpoint(last_segment);
+    } else {
+        qWarning() << "重放结果未能全部写回存档，保留修改日志";
+        m_journal_pinned = true;
     }
 }
 
-void OpenGLWindow::initializeSunlight() {
-    const int world_size_in_chunks = 24;
-    const int min_world_x = -world_size_in_chunks / 2 * CHUNK_SIZE_XZ;
-    const int max_world_x = world_size_in_chunks / 2 * CHUNK_SIZE_XZ;
-    const int min_world_z = -world_size_in_chunks / 2 * CHUNK_SIZE_XZ;
-    const int max_world_z = world_size_in_chunks / 2 * CHUNK_SIZE_XZ;
-    const int max_world_y = WORLD_HEIGHT_IN_BLOCKS - 1;
-    const int min_world_y = 0;
-
-
-    qDebug() << "Initializing sunlight from y=" << max_world_y << "downwards...";
-
-    while(!m_light_propagation_queue.empty()) m_light_propagation_queue.pop();
-
-    for (int x = min_world_x; x < max_world_x; ++x) {
-        for (int z = min_world_z; z < max_world_z; ++z) {
-            bool light_blocked = false;
-            for (int y = max_world_y; y >= min_world_y; --y) {
-                glm::ivec3 world_pos(x, y, z);
-                if (!light_blocked) {
-                    BlockType block_type = static_cast<BlockType>(getBlock(world_pos));
-                    if (block_type == BlockType::Air || block_type == BlockType::Water) {
-                        setLight(world_pos, 15);
-                        m_light_propagation_queue.push({world_pos, 15});
-                    } else {
-                        light_blocked = true;
-                    }
-                } else {
-                    //一旦被阻挡，如果下方还有区块，理论上光照应为0，但我们的setLight默认就是0，所以这里可以不做操作
-                }
-            }
+void OpenGLWindow::releaseChunkMesh(Chunk* chunk)
+{
+    // GL 对象随区块留在对象池中复用，这里只释放显存；调用时 GL 上下文必须为当前
+    if (chunk->vbo.isCreated()) {
+        chunk->vbo.bind();
+        chunk->vbo.allocate(0);
+        chunk->vbo.release();
+    }
+    if (chunk->vbo_transparent.isCreated()) {
+        chunk->vbo_transparent.bind();
+        chunk->vbo_transparent.allocate(0);
+        chunk->vbo_transparent.release();
+    }
+    chunk->vertex_count = 0;
+    chunk->vertex_count_transparent = 0;
+}
+
+bool OpenGLWindow::isLightSettled(const Chunk* chunk) const
+{
+    // 天空光队列里只有区块插入时入队的节点（方块修改引起的光照更新是同步完成的），
+    // 这些节点在插入的区块及其边界上，最多再传播 15 格，只会改动插入的区块和它周围一圈区块。
+    // 所以周围一圈区块都在队列最近一次清空之前插入时，这个区块的光照不会再变
+    if (m_sky_light.isSettled()) return true;
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dz = -1; dz <= 1; ++dz) {
+            const Chunk* nearby = m_chunks.find(chunk->coords.x + dx, chunk->coords.z + dz);
+            if (nearby && nearby->insert_sequence > m_light_settled_sequence) return false;
         }
     }
+    return true;
+}
+
+glm::mat4 OpenGLWindow::updateCameraFrustum()
+{
+    glm::vec3 player_pos_backup = m_camera.Position;
+    m_camera.Position.y += PLAYER_EYE_LEVEL;
+    glm::mat4 view = m_camera.GetViewMatrix();
+    m_camera.Position = player_pos_backup;
+
+    // 窗口还没有显示时高度可能为 0
+    float aspect_ratio = float(width()) / float(std::max(height(), 1));
+    glm::mat4 projection = glm::perspective(glm::radians(m_camera.Zoom), aspect_ratio, 0.1f, 500.0f);
 
-    qDebug() << "Sunlight initialized. Queue size:" << m_light_propagation_queue.size();
-    qDebug() << "Initial light propagation will be processed in game loop.";
+    m_camera.UpdateFrustum(projection, view);
+    return projection * view;
 }
 
 void OpenGLWindow::resizeGL(int w, int h)
@@ -476,98 +906,129 @@ void OpenGLWindow::updateGame()
 
     processInput();
     updatePhysics(delta_time);
+    m_scheduler.update(m_camera);
 
-    if (!m_light_propagation_queue.empty()) {
+    if (!m_sky_light.isSettled()) {
         const int light_updates_per_frame = 20000;
-        const glm::ivec3 neighbors[6] = {
-            {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
-        };
-
-        for (int i = 0; i < light_updates_per_frame && !m_light_propagation_queue.empty(); ++i) {
-            auto [pos, light_level] = m_light_propagation_queue.front();
-            m_light_propagation_queue.pop();
-
-            if (light_level <= 1) continue;
-
-            for (const auto& offset : neighbors) {
-                glm::ivec3 neighbor_pos = pos + offset;
-                BlockType neighbor_block_type = static_cast<BlockType>(getBlock(neighbor_pos));
-                bool is_transparent = (neighbor_block_type == BlockType::Air || neighbor_block_type == BlockType::Water);
-
-                if (is_transparent && getLight(neighbor_pos) < light_level - 1) {
-                    setLight(neighbor_pos, light_level - 1);
-                    m_light_propagation_queue.push({neighbor_pos, static_cast<uint8_t>(light_level - 1)});
-                }
-            }
-        }
+        m_sky_light.propagate(light_updates_per_frame);
     }
+    if (m_sky_light.isSettled()) m_light_settled_sequence = m_insert_sequence;
 
-    m_ready_chunks_mutex.lock();
-    if (!m_ready_chunks.isEmpty()) {
-        makeCurrent();
-        for (Chunk* chunk : m_ready_chunks) {
-            if(chunk->mesh_data.size() > 0) {
-                if (!chunk->vao.isCreated()) chunk->vao.create();
-                chunk->vao.bind();
-                if (!chunk->vbo.isCreated()) {
-                    chunk->vbo.create();
-                    chunk->vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-                }
-                chunk->vbo.bind();
-                chunk->vbo.allocate(chunk->mesh_data.data(), chunk->mesh_data.size() * sizeof(Vertex));
-                chunk->vertex_count = chunk->mesh_data.size();
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-                glEnableVertexAttribArray(2);
-                glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightLevel));
-                chunk->vao.release();
-            }
-            chunk->mesh_data.clear();
-            chunk->mesh_data.shrink_to_fit();
-
-            if(chunk->mesh_data_transparent.size() > 0) {
-                if (!chunk->vao_transparent.isCreated()) chunk->vao_transparent.create();
-                chunk->vao_transparent.bind();
-                if (!chunk->vbo_transparent.isCreated()) {
-                    chunk->vbo_transparent.create();
-                    chunk->vbo_transparent.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-                }
-                chunk->vbo_transparent.bind();
-                chunk->vbo_transparent.allocate(chunk->mesh_data_transparent.data(), chunk->mesh_data_transparent.size() * sizeof(Vertex));
-                chunk->vertex_count_transparent = chunk->mesh_data_transparent.size();
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-                glEnableVertexAttribArray(2);
-                glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightLevel));
-                chunk->vao_transparent.release();
-            }
-            chunk->mesh_data_transparent.clear();
-            chunk->mesh_data_transparent.shrink_to_fit();
+    std::vector<ChunkMesh> ready_meshes;
+    m_ready_meshes_mutex.lock();
+    ready_meshes.swap(m_ready_meshes);
+    m_ready_meshes_mutex.unlock();
+    m_meshes_in_flight -= static_cast<int>(ready_meshes.size());
 
+    if (!ready_meshes.empty()) {
+        makeCurrent();
+        for (const ChunkMesh& mesh : ready_meshes) {
+            Chunk* chunk = currentMeshTarget(mesh);
+            if (!chunk) continue;
+            uploadChunkMesh(chunk, mesh.opaque, mesh.transparent);
             chunk->is_building = false;
         }
         doneCurrent();
-        m_ready_chunks.clear();
     }
-    m_ready_chunks_mutex.unlock();
 
-    for (auto const& [coords, chunk] : m_chunks) {
-        if (chunk->needs_remeshing && !chunk->is_building) {
-            chunk->is_building = true;
-            chunk->needs_remeshing = false;
-            QtConcurrent::run(this, &OpenGLWindow::buildChunkMesh, chunk.get());
+    updateChunkStreaming();
+    runAutosave();
+    // 组提交：本帧的所有方块修改合成一批写入日志
+    m_journal.commit();
+    // 写入失败的批次由日志自己重试，这里只在状态变化时提示一次
+    if (m_journal.hasUnwrittenBatches() != m_journal_write_failing) {
+        m_journal_write_failing = !m_journal_write_failing;
+        if (m_journal_write_failing) {
+            qWarning() << "修改日志写入失败，最近的修改暂存在内存中，崩溃会丢失这些修改";
+        } else {
+            qDebug() << "修改日志已恢复写入";
+        }
+    }
+
+    // 网格任务按调度优先级派发，在途数量受限，近处和视锥内的区块先出现；
+    // 没派发的留到下一帧按新的摄像机位置重新排序
+    const int max_meshes_in_flight = std::max(QThread::idealThreadCount(), 1) * 4;
+    if (m_meshes_in_flight < max_meshes_in_flight) {
+        std::vector<glm::ivec3> dirty_chunks;
+        for (const auto& chunk : m_chunks) {
+            if (chunk->needs_remeshing && !chunk->is_building) dirty_chunks.push_back(chunk->coords);
+        }
+        m_scheduler.sortByPriority(dirty_chunks);
+
+        for (const glm::ivec3& coords : dirty_chunks) {
+            if (m_meshes_in_flight >= max_meshes_in_flight) break;
+            ++m_meshes_in_flight;
+            dispatchChunkMesh(m_chunks.find(coords));
         }
     }
 
     update();
 }
 
+void OpenGLWindow::dispatchChunkMesh(Chunk* chunk)
+{
+    chunk->is_building = true;
+    chunk->needs_remeshing = false;
+    ++chunk->build_serial;
+    // 在主线程取快照，之后的编辑写入新版本，不会影响正在构建的网格
+    QtConcurrent::run(this, &OpenGLWindow::buildChunkMesh,
+                      std::shared_ptr<const ChunkSnapshot>(std::make_shared<ChunkSnapshot>(*chunk)),
+                      chunk, chunk->insert_sequence, chunk->build_serial);
+}
+
+Chunk* OpenGLWindow::currentMeshTarget(const ChunkMesh& mesh) const
+{
+    Chunk* chunk = m_chunks.find(mesh.coords);
+    if (!chunk || chunk != mesh.chunk || chunk->insert_sequence != mesh.insert_sequence ||
+        chunk->build_serial != mesh.build_serial) {
+        return nullptr;
+    }
+    return chunk;
+}
+
 void OpenGLWindow::handleChunkMeshReady() {}
 
+void OpenGLWindow::uploadChunkMesh(Chunk* chunk, const std::vector<Vertex>& opaque, const std::vector<Vertex>& transparent)
+{
+    if (opaque.size() > 0) {
+        if (!chunk->vao.isCreated()) chunk->vao.create();
+        chunk->vao.bind();
+        if (!chunk->vbo.isCreated()) {
+            chunk->vbo.create();
+            chunk->vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        }
+        chunk->vbo.bind();
+        chunk->vbo.allocate(opaque.data(), opaque.size() * sizeof(Vertex));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightLevel));
+        chunk->vao.release();
+    }
+    chunk->vertex_count = opaque.size();
+
+    if (transparent.size() > 0) {
+        if (!chunk->vao_transparent.isCreated()) chunk->vao_transparent.create();
+        chunk->vao_transparent.bind();
+        if (!chunk->vbo_transparent.isCreated()) {
+            chunk->vbo_transparent.create();
+            chunk->vbo_transparent.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        }
+        chunk->vbo_transparent.bind();
+        chunk->vbo_transparent.allocate(transparent.data(), transparent.size() * sizeof(Vertex));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightLevel));
+        chunk->vao_transparent.release();
+    }
+    chunk->vertex_count_transparent = transparent.size();
+}
+
 void OpenGLWindow::paintGL()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -581,24 +1042,17 @@ void OpenGLWindow::paintGL()
     glActiveTexture(GL_TEXTURE0);
     m_texture_atlas->bind();
 
-    glm::vec3 player_pos_backup = m_camera.Position;
-    m_camera.Position.y += PLAYER_EYE_LEVEL;
-    glm::mat4 view = m_camera.GetViewMatrix();
-    m_camera.Position = player_pos_backup;
-
-    float aspect_ratio = float(width()) / float(height());
-    glm::mat4 projection = glm::perspective(glm::radians(m_camera.Zoom), aspect_ratio, 0.1f, 500.0f);
-
-    m_camera.UpdateFrustum(projection, view);
-
-    glm::mat4 vp = projection * view;
+    glm::mat4 vp = updateCameraFrustum();
     glUniformMatrix4fv(m_vp_matrix_location, 1, GL_FALSE, glm::value_ptr(vp));
 
     glDepthMask(GL_TRUE);
-    for (auto const& [coords, chunk_ptr] : m_chunks) {
+    for (const auto& chunk_ptr : m_chunks) {
         Chunk* chunk = chunk_ptr.get();
+        const glm::ivec3& coords = chunk->coords;
+        // 包围盒只覆盖到最高的非空子区块，上方的空气不参与视锥剔除
+        float top = (chunk->highestNonEmptySection() + 1) * SECTION_SIZE;
         glm::vec3 min_aabb = glm::vec3(coords.x * CHUNK_SIZE_XZ, 0, coords.z * CHUNK_SIZE_XZ);
-        glm::vec3 max_aabb = min_aabb + glm::vec3(CHUNK_SIZE_XZ, WORLD_HEIGHT_IN_BLOCKS, CHUNK_SIZE_XZ);
+        glm::vec3 max_aabb = min_aabb + glm::vec3(CHUNK_SIZE_XZ, top, CHUNK_SIZE_XZ);
 
         if (chunk->vertex_count > 0 && chunk->vao.isCreated()&& m_camera.IsBoxInFrustum(min_aabb, max_aabb)) {
             glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(coords.x * CHUNK_SIZE_XZ, 0, coords.z * CHUNK_SIZE_XZ));
@@ -610,8 +1064,9 @@ void OpenGLWindow::paintGL()
     }
 
     std::multimap<float, Chunk*> sorted_transparent_chunks;
-    for (auto const& [coords, chunk_ptr] : m_chunks) {
+    for (const auto& chunk_ptr : m_chunks) {
         Chunk* chunk = chunk_ptr.get();
+        const glm::ivec3& coords = chunk->coords;
         if (chunk->vertex_count_transparent > 0) {
             glm::vec3 chunk_center = glm::vec3(coords.x * CHUNK_SIZE_XZ, WORLD_HEIGHT_IN_BLOCKS / 2.0f, coords.z * CHUNK_SIZE_XZ) + glm::vec3(CHUNK_SIZE_XZ / 2.0f);
             float dist = glm::distance2(m_camera.Position, chunk_center);
@@ -622,8 +1077,9 @@ void OpenGLWindow::paintGL()
     glDepthMask(GL_FALSE);
     for (auto it = sorted_transparent_chunks.rbegin(); it != sorted_transparent_chunks.rend(); ++it) {
         Chunk* chunk = it->second;
+        float top = (chunk->highestNonEmptySection() + 1) * SECTION_SIZE;
         glm::vec3 min_aabb = glm::vec3(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ);
-        glm::vec3 max_aabb = min_aabb + glm::vec3(CHUNK_SIZE_XZ, WORLD_HEIGHT_IN_BLOCKS, CHUNK_SIZE_XZ);
+        glm::vec3 max_aabb = min_aabb + glm::vec3(CHUNK_SIZE_XZ, top, CHUNK_SIZE_XZ);
 
         if (chunk->vao_transparent.isCreated() && m_camera.IsBoxInFrustum(min_aabb, max_aabb)) {
             glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ));
@@ -678,14 +1134,7 @@ void OpenGLWindow::paintGL()
     for (int i = 0; i < INVENTORY_SLOTS; ++i) {
         BlockType item_type = m_inventory.getItem(i).type;
         if (item_type != BlockType::Air) {
-            int texture_index = 0;
-            switch (item_type) {
-            case BlockType::Stone: texture_index = Texture::Stone; break;
-            case BlockType::Dirt:  texture_index = Texture::Dirt;  break;
-            case BlockType::Grass: texture_index = Texture::GrassSide; break;
-            case BlockType::Water: texture_index = Texture::Water; break;
-            default: continue;
-            }
+            int texture_index = blockProperties(item_type).face_textures[FACE_POS_Z];
             float u_offset = texture_index * Texture::TileWidth;
             glUniform2f(m_ui_uv_offset_location, u_offset, 0.0f);
 
@@ -724,6 +1173,13 @@ void OpenGLWindow::paintGL()
     glDrawArrays(GL_LINES, 0, 4);
     m_crosshair_vao.release();
     m_crosshair_program.release();
+
+    if (!m_first_frame_reported) {
+        // 首帧耗时：从窗口创建到第一帧的绘制命令全部执行完
+        glFinish();
+        m_first_frame_reported = true;
+        qDebug() << "首帧用时" << m_startup_timer.elapsed() << "ms，画出了" << m_chunks.size() << "个区块。";
+    }
 }
 
 void OpenGLWindow::processInput()
@@ -789,6 +1245,14 @@ AABB OpenGLWindow::getPlayerAABB(const glm::vec3& position) const
     };
 }
 
+WorldView OpenGLWindow::collisionView(const AABB& box) const
+{
+    // 推出方块时玩家包围盒最多移动一格，多取一圈保证循环中途更新的范围仍在视图内
+    return WorldView(m_chunks,
+                     glm::ivec3(glm::floor(box.min)) - glm::ivec3(1),
+                     glm::ivec3(glm::floor(box.max)) + glm::ivec3(1));
+}
+
 void OpenGLWindow::resolveCollisions(glm::vec3& position, const glm::vec3& velocity)
 {
     m_is_on_ground = false;
@@ -796,12 +1260,12 @@ void OpenGLWindow::resolveCollisions(glm::vec3& position, const glm::vec3& veloc
 
     position.x += velocity.x;
     player_box = getPlayerAABB(position);
+    WorldView view_x = collisionView(player_box);
 
     for (int y = floor(player_box.min.y); y <= floor(player_box.max.y); ++y) {
         for (int x = floor(player_box.min.x); x <= floor(player_box.max.x); ++x) {
             for (int z = floor(player_box.min.z); z <= floor(player_box.max.z); ++z) {
-                BlockType block_type = static_cast<BlockType>(getBlock({x, y, z}));
-                if (block_type != BlockType::Air && block_type != BlockType::Water) {
+                if (isSolid(view_x.getBlock(x, y, z))) {
                     AABB block_box = {glm::vec3(x, y, z), glm::vec3(x + 1, y + 1, z + 1)};
                     if (player_box.max.x > block_box.min.x && player_box.min.x < block_box.max.x &&
                         player_box.max.y > block_box.min.y && player_box.min.y < block_box.max.y &&
@@ -818,12 +1282,12 @@ void OpenGLWindow::resolveCollisions(glm::vec3& position, const glm::vec3& veloc
 
     position.z += velocity.z;
     player_box = getPlayerAABB(position);
+    WorldView view_z = collisionView(player_box);
 
     for (int y = floor(player_box.min.y); y <= floor(player_box.max.y); ++y) {
         for (int x = floor(player_box.min.x); x <= floor(player_box.max.x); ++x) {
             for (int z = floor(player_box.min.z); z <= floor(player_box.max.z); ++z) {
-                BlockType block_type = static_cast<BlockType>(getBlock({x, y, z}));
-                if (block_type != BlockType::Air && block_type != BlockType::Water) {
+                if (isSolid(view_z.getBlock(x, y, z))) {
                     AABB block_box = {glm::vec3(x, y, z), glm::vec3(x + 1, y + 1, z + 1)};
                     if (player_box.max.x > block_box.min.x && player_box.min.x < block_box.max.x &&
                         player_box.max.y > block_box.min.y && player_box.min.y < block_box.max.y &&
@@ -840,12 +1304,12 @@ void OpenGLWindow::resolveCollisions(glm::vec3& position, const glm::vec3& veloc
 
     position.y += velocity.y;
     player_box = getPlayerAABB(position);
+    WorldView view_y = collisionView(player_box);
 
     for (int y = floor(player_box.min.y); y <= floor(player_box.max.y); ++y) {
         for (int x = floor(player_box.min.x); x <= floor(player_box.max.x); ++x) {
             for (int z = floor(player_box.min.z); z <= floor(player_box.max.z); ++z) {
-                BlockType block_type = static_cast<BlockType>(getBlock({x, y, z}));
-                if (block_type != BlockType::Air && block_type != BlockType::Water) {
+                if (isSolid(view_y.getBlock(x, y, z))) {
                     AABB block_box = {glm::vec3(x, y, z), glm::vec3(x + 1, y + 1, z + 1)};
                     if (player_box.max.x > block_box.min.x && player_box.min.x < block_box.max.x &&
                         player_box.max.y > block_box.min.y && player_box.min.y < block_box.max.y &&
@@ -949,47 +1413,30 @@ void OpenGLWindow::wheelEvent(QWheelEvent *event)
     update();
 }
 
-uint8_t OpenGLWindow::getLight(const glm::ivec3& world_pos) {
-    if (world_pos.y < 0 || world_pos.y >= WORLD_HEIGHT_IN_BLOCKS) return 0;
+Chunk* OpenGLWindow::findChunkForBlock(const glm::ivec3& world_pos, glm::ivec3& local_pos) {
+    if (world_pos.y < 0 || world_pos.y >= WORLD_HEIGHT_IN_BLOCKS) return nullptr;
 
-    glm::ivec3 chunk_coords = worldToChunkCoords(world_pos);
-    auto it = m_chunks.find(chunk_coords);
-    if (it == m_chunks.end()) return 0;
-
-    Chunk* chunk = it->second.get();
-    int local_x = world_pos.x - chunk_coords.x * CHUNK_SIZE_XZ;
-    int local_y = world_pos.y;
-    int local_z = world_pos.z - chunk_coords.z * CHUNK_SIZE_XZ;
+    Chunk* chunk = m_chunks.find(blockToChunk(world_pos.x), blockToChunk(world_pos.z));
+    if (!chunk) return nullptr;
 
-    if (local_x < 0 || local_x >= CHUNK_SIZE_XZ ||
-        local_y < 0 || local_y >= WORLD_HEIGHT_IN_BLOCKS ||
-        local_z < 0 || local_z >= CHUNK_SIZE_XZ) {
-        return 0;
-    }
-
-    return chunk->lighting[local_x][local_y][local_z];
+    local_pos = glm::ivec3(blockToLocal(world_pos.x), world_pos.y, blockToLocal(world_pos.z));
+    return chunk;
 }
 
-void OpenGLWindow::setLight(const glm::ivec3& world_pos, uint8_t level) {
-    if (world_pos.y < 0 || world_pos.y >= WORLD_HEIGHT_IN_BLOCKS) return;
-
-    glm::ivec3 chunk_coords = worldToChunkCoords(world_pos);
-    auto it = m_chunks.find(chunk_coords);
-    if (it == m_chunks.end()) return;
-
-    Chunk* chunk = it->second.get();
-    int local_x = world_pos.x - chunk_coords.x * CHUNK_SIZE_XZ;
-    int local_y = world_pos.y;
-    int local_z = world_pos.z - chunk_coords.z * CHUNK_SIZE_XZ;
+uint8_t OpenGLWindow::getBlockLight(const glm::ivec3& world_pos) {
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return 0;
+    return chunk->getBlockLight(local_pos.x, local_pos.y, local_pos.z);
+}
 
-    if (local_x < 0 || local_x >= CHUNK_SIZE_XZ ||
-        local_y < 0 || local_y >= WORLD_HEIGHT_IN_BLOCKS ||
-        local_z < 0 || local_z >= CHUNK_SIZE_XZ) {
-        return;
-    }
+void OpenGLWindow::setBlockLight(const glm::ivec3& world_pos, uint8_t level) {
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return;
 
-    if (chunk->lighting[local_x][local_y][local_z] != level) {
-        chunk->lighting[local_x][local_y][local_z] = level;
+    if (chunk->getBlockLight(local_pos.x, local_pos.y, local_pos.z) != level) {
+        chunk->setBlockLight(local_pos.x, local_pos.y, local_pos.z, level);
         chunk->needs_remeshing = true;
     }
 }
@@ -999,92 +1446,13 @@ uint8_t OpenGLWindow::getBlock(const glm::ivec3& world_pos) {
         return static_cast<uint8_t>(BlockType::Air);
     }
 
-    glm::ivec3 chunk_coords = worldToChunkCoords(world_pos);
-    auto it = m_chunks.find(chunk_coords);
-    if (it == m_chunks.end()) return static_cast<uint8_t>(BlockType::Air);
-
-    Chunk* chunk = it->second.get();
-    int local_x = world_pos.x - chunk_coords.x * CHUNK_SIZE_XZ;
-    int local_y = world_pos.y;
-    int local_z = world_pos.z - chunk_coords.z * CHUNK_SIZE_XZ;
-
-    if (local_x < 0 || local_x >= CHUNK_SIZE_XZ ||
-        local_y < 0 || local_y >= WORLD_HEIGHT_IN_BLOCKS ||
-        local_z < 0 || local_z >= CHUNK_SIZE_XZ) {
-        return static_cast<uint8_t>(BlockType::Air);
-    }
-
-    return chunk->blocks[local_x][local_y][local_z];
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return static_cast<uint8_t>(BlockType::Air);
+    return static_cast<uint8_t>(chunk->getBlock(local_pos.x, local_pos.y, local_pos.z));
 }
 // openglwindow.cpp
 
-void OpenGLWindow::removeLight(std::queue<LightNode>& removal_queue) {
-    const glm::ivec3 neighbors[6] = {
-        {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
-    };
-
-    std::queue<LightNode> propagation_queue;
-
-    while (!removal_queue.empty()) {
-        auto [pos, light_level] = removal_queue.front();
-        removal_queue.pop();
-
-        for (const auto& offset : neighbors) {
-            glm::ivec3 neighbor_pos = pos + offset;
-            uint8_t neighbor_light = getLight(neighbor_pos);
-
-            // 如果邻居没有光，直接跳过
-            if (neighbor_light == 0) {
-                continue;
-            }
-
-            // BUG 修复:
-            // 旧的逻辑是 `neighbor_light > light_level`，这会忽略 `neighbor_light == light_level` 的情况，
-            // 导致移除阳光(level 15)时，无法正确处理同样是level 15的邻居，光照移除中断。
-            //
-            // 新的逻辑:
-            // 如果邻居的光照等级严格小于我们正在移除的光源等级，那么它之前可能是被这个光源照亮的。
-            // 现在光源没了，它的光也需要被移除并重新计算。
-            if (neighbor_light < light_level) {
-                setLight(neighbor_pos, 0);
-                removal_queue.push({neighbor_pos, neighbor_light});
-            }
-            // 如果邻居的光照等级大于或等于我们移除的光源等级，说明它有独立的、更强或同样强的光源。
-            // 它现在应该成为一个新的光源，去尝试照亮刚刚变暗的区域。
-            else { // 这等同于 if (neighbor_light >= light_level)
-                propagation_queue.push({neighbor_pos, neighbor_light});
-            }
-        }
-    }
-
-    // 在所有需要移除的光被移除后，从边界上的光源开始重新传播光线。
-    propagateLight(propagation_queue);
-}
-
-void OpenGLWindow::propagateLight(std::queue<LightNode>& propagation_queue) {
-    const glm::ivec3 neighbors[6] = {
-        {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
-    };
-
-    while (!propagation_queue.empty()) {
-        auto [pos, light_level] = propagation_queue.front();
-        propagation_queue.pop();
-
-        if (light_level <= 1) continue;
-
-        for (const auto& offset : neighbors) {
-            glm::ivec3 neighbor_pos = pos + offset;
-            BlockType neighbor_block_type = static_cast<BlockType>(getBlock(neighbor_pos));
-            bool is_transparent = (neighbor_block_type == BlockType::Air || neighbor_block_type == BlockType::Water);
-
-            if (is_transparent && getLight(neighbor_pos) < light_level - 1) {
-                setLight(neighbor_pos, light_level - 1);
-                propagation_queue.push({neighbor_pos, static_cast<uint8_t>(light_level - 1)});
-            }
-        }
-    }
-}
-
 // 修正: setBlock，在执行光照计算前清空全局光照队列，防止冲突
 void OpenGLWindow::setBlock(const glm::ivec3& world_pos, BlockType block_id) {
     if (world_pos.y < 0 || world_pos.y >= WORLD_HEIGHT_IN_BLOCKS) {
@@ -1092,12 +1460,11 @@ void OpenGLWindow::setBlock(const glm::ivec3& world_pos, BlockType block_id) {
     }
 
     glm::ivec3 chunk_coords = worldToChunkCoords(world_pos);
-    auto it = m_chunks.find(chunk_coords);
-    if (it == m_chunks.end()) {
+    Chunk* chunk = m_chunks.find(chunk_coords);
+    if (!chunk) {
         return;
     }
 
-    Chunk* chunk = it->second.get();
     int local_x = world_pos.x - chunk_coords.x * CHUNK_SIZE_XZ;
     int local_y = world_pos.y;
     int local_z = world_pos.z - chunk_coords.z * CHUNK_SIZE_XZ;
@@ -1108,115 +1475,32 @@ void OpenGLWindow::setBlock(const glm::ivec3& world_pos, BlockType block_id) {
         return;
     }
 
-    BlockType old_block_type = static_cast<BlockType>(chunk->blocks[local_x][local_y][local_z]);
+    BlockType old_block_type = chunk->getBlock(local_x, local_y, local_z);
     if (old_block_type == block_id) {
         return;
     }
 
-    uint8_t old_light_level = getLight(world_pos);
-    chunk->blocks[local_x][local_y][local_z] = static_cast<uint8_t>(block_id);
+    chunk->setBlock(local_x, local_y, local_z, block_id);
     chunk->needs_remeshing = true;
+    m_journal.append(world_pos, old_block_type, block_id);
 
-    // --- BUG 修复的关键 ---
-    // 在执行任何新的、即时的光照计算之前，清空全局的、异步的光照队列。
-    // 这可以防止旧的、待处理的光照更新覆盖掉我们即将进行的、由玩家直接触发的更新。
-    // 这是解决“放置方块后光照有时不更新”问题的核心。
-    std::queue<LightNode> empty_queue;
-    m_light_propagation_queue.swap(empty_queue);
-    // ----------------------
-
-    bool was_transparent = (old_block_type == BlockType::Air || old_block_type == BlockType::Water);
-    bool is_transparent = (block_id == BlockType::Air || block_id == BlockType::Water);
-
-    if (was_transparent == is_transparent) {
-        // 透明度未变，光照逻辑不变
-    }
-    else if (!is_transparent) {
-        // 放置不透明方块 -> 移除光线
-        if (old_light_level > 0) {
-            std::queue<LightNode> light_removal_queue;
-            light_removal_queue.push({world_pos, old_light_level});
-            setLight(world_pos, 0);
-            removeLight(light_removal_queue);
-        }
-    }
-    else {
-        // 移除不透明方块 -> 传播光线
-        std::queue<LightNode> light_propagation_queue;
-        uint8_t max_neighbor_light = 0;
-        const glm::ivec3 neighbors[6] = {
-            {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
-        };
-        for (const auto& offset : neighbors) {
-            max_neighbor_light = std::max(max_neighbor_light, getLight(world_pos + offset));
-        }
-
-        uint8_t new_light_level = 0;
-        if (max_neighbor_light > 0) {
-            new_light_level = max_neighbor_light - 1;
-        }
-
-        bool exposed_to_sky = true;
-        for (int y = world_pos.y + 1; y < WORLD_HEIGHT_IN_BLOCKS; ++y) {
-            BlockType block_above = static_cast<BlockType>(getBlock({world_pos.x, y, world_pos.z}));
-            if (block_above != BlockType::Air && block_above != BlockType::Water) {
-                exposed_to_sky = false;
-                break;
-            }
-        }
-
-        if (exposed_to_sky) {
-            new_light_level = 15;
-            for (int y = world_pos.y; y >= 0; --y) {
-                glm::ivec3 current_pos(world_pos.x, y, world_pos.z);
-                BlockType current_block = static_cast<BlockType>(getBlock(current_pos));
-                if (current_block != BlockType::Air && current_block != BlockType::Water) {
-                    break;
-                }
-                if (getLight(current_pos) < 15) {
-                    setLight(current_pos, 15);
-                    light_propagation_queue.push({current_pos, 15});
-                }
-            }
-        }
-
-        uint8_t current_light = getLight(world_pos);
-        if (new_light_level > current_light) {
-            setLight(world_pos, new_light_level);
-            light_propagation_queue.push({world_pos, new_light_level});
-        }
-
-        if (!light_propagation_queue.empty()) {
-            propagateLight(light_propagation_queue);
-        }
-    }
+    m_sky_light.updateBlock(world_pos, old_block_type);
 
     // 标记邻近区块需要重新构建网格
-    if (local_x == 0) {
-        auto neighbor_it = m_chunks.find(chunk_coords + glm::ivec3(-1, 0, 0));
-        if (neighbor_it != m_chunks.end()) neighbor_it->second->needs_remeshing = true;
-    }
-    if (local_x == CHUNK_SIZE_XZ - 1) {
-        auto neighbor_it = m_chunks.find(chunk_coords + glm::ivec3(1, 0, 0));
-        if (neighbor_it != m_chunks.end()) neighbor_it->second->needs_remeshing = true;
-    }
-    if (local_z == 0) {
-        auto neighbor_it = m_chunks.find(chunk_coords + glm::ivec3(0, 0, -1));
-        if (neighbor_it != m_chunks.end()) neighbor_it->second->needs_remeshing = true;
-    }
-    if (local_z == CHUNK_SIZE_XZ - 1) {
-        auto neighbor_it = m_chunks.find(chunk_coords + glm::ivec3(0, 0, 1));
-        if (neighbor_it != m_chunks.end()) neighbor_it->second->needs_remeshing = true;
-    }
+    Chunk* neighbor = nullptr;
+    if (local_x == 0) neighbor = chunk->neighbors[NEIGHBOR_NEG_X];
+    if (local_x == CHUNK_SIZE_XZ - 1) neighbor = chunk->neighbors[NEIGHBOR_POS_X];
+    if (neighbor) neighbor->needs_remeshing = true;
+
+    neighbor = nullptr;
+    if (local_z == 0) neighbor = chunk->neighbors[NEIGHBOR_NEG_Z];
+    if (local_z == CHUNK_SIZE_XZ - 1) neighbor = chunk->neighbors[NEIGHBOR_POS_Z];
+    if (neighbor) neighbor->needs_remeshing = true;
 }
 
 
 glm::ivec3 OpenGLWindow::worldToChunkCoords(const glm::ivec3& world_pos) {
-    return {
-        (int)floor(world_pos.x / (float)CHUNK_SIZE_XZ),
-        0, // Y 坐标总是 0
-        (int)floor(world_pos.z / (float)CHUNK_SIZE_XZ)
-    };
+    return { blockToChunk(world_pos.x), 0, blockToChunk(world_pos.z) }; // Y 坐标总是 0
 }
 
 bool OpenGLWindow::raycast(glm::ivec3 &hit_block, glm::ivec3 &adjacent_block)
@@ -1236,7 +1520,10 @@ bool OpenGLWindow::raycast(glm::ivec3 &hit_block, glm::ivec3 &adjacent_block)
     t_max.y = (ray_direction.y > 0.0f) ? (current_pos.y + 1.0f - ray_origin.y) * t_delta.y : (ray_origin.y - current_pos.y) * t_delta.y;
     t_max.z = (ray_direction.z > 0.0f) ? (current_pos.z + 1.0f - ray_origin.z) * t_delta.z : (ray_origin.z - current_pos.z) * t_delta.z;
 
-    for (int i = 0; i < 100; ++i) {
+    // 射线最多前进 RAYCAST_MAX_STEPS 格，视图覆盖整个可达范围，区块按需解析
+    const WorldView view(m_chunks, current_pos - glm::ivec3(RAYCAST_MAX_STEPS), current_pos + glm::ivec3(RAYCAST_MAX_STEPS));
+
+    for (int i = 0; i < RAYCAST_MAX_STEPS; ++i) {
         last_pos = current_pos;
 
         if (t_max.x < t_max.y) {
@@ -1247,7 +1534,7 @@ bool OpenGLWindow::raycast(glm::ivec3 &hit_block, glm::ivec3 &adjacent_block)
             else { current_pos.z += step.z; t_max.z += t_delta.z; }
         }
 
-        if (getBlock(current_pos) != static_cast<uint8_t>(BlockType::Air)) {
+        if (view.getBlock(current_pos) != BlockType::Air) {
             hit_block = current_pos;
             adjacent_block = last_pos;
             return true;
@@ -1256,13 +1543,37 @@ bool OpenGLWindow::raycast(glm::ivec3 &hit_block, glm::ivec3 &adjacent_block)
     return false;
 }
 
-void OpenGLWindow::buildChunkMesh(Chunk* chunk)
+bool OpenGLWindow::isSectionHidden(const ChunkSnapshot& snapshot, int section_index)
+{
+    const ChunkSection& section = snapshot.section(section_index);
+    if (section.isEmpty()) return true;
+    if (!section.isUniform()) return false;
+
+    // 与网格构建使用同一条面可见性规则
+    const BlockType type = section.uniformBlock();
+    auto hides = [type](const ChunkSection& other) {
+        return other.isUniform() && !isFaceVisible(type, other.uniformBlock());
+    };
+
+    // 世界的上下边界外视为空气
+    if (section_index == 0 || !hides(snapshot.section(section_index - 1))) return false;
+    if (section_index == SECTIONS_PER_CHUNK - 1 || !hides(snapshot.section(section_index + 1))) return false;
+
+    for (int n = 0; n < NEIGHBOR_COUNT; ++n) {
+        const ChunkSection* neighbor = snapshot.neighborSection(n, section_index);
+        if (!neighbor || !hides(*neighbor)) return false;
+    }
+    return true;
+}
+
+void OpenGLWindow::buildChunkMesh(std::shared_ptr<const ChunkSnapshot> snapshot, const Chunk* chunk_ptr,
+                                  uint64_t insert_sequence, uint64_t build_serial)
 {
+    // 只读取快照，不访问 Chunk 本身，主线程可以同时编辑、卸载这个区块；chunk_ptr 只用来核对结果
+    const ChunkSnapshot& chunk = *snapshot;
     std::vector<Vertex> vertices_opaque;
     std::vector<Vertex> vertices_transparent;
 
-    glm::vec3 chunk_base_pos = glm::vec3(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ);
-
     const glm::vec3 face_vertices[6][4] = {
         { {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1} }, // Front (+z)
         { {1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {1, 1, 0} }, // Back (-z)
@@ -1272,54 +1583,43 @@ void OpenGLWindow::buildChunkMesh(Chunk* chunk)
         { {0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0} }  // Left (-x)
     };
 
-    for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
-        for (int y = 0; y < WORLD_HEIGHT_IN_BLOCKS; ++y) {
-            for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
-                BlockType block_id = static_cast<BlockType>(chunk->blocks[x][y][z]);
-                if (block_id == BlockType::Air) continue;
+    // 全空的子区块，以及被同类均一子区块完全包围的均一子区块，都不会产生任何可见面
+    bool skip_section[SECTIONS_PER_CHUNK];
+    for (int s = 0; s < SECTIONS_PER_CHUNK; ++s) {
+        skip_section[s] = isSectionHidden(chunk, s);
+    }
+
+    // 按 RenderLayer 的数值索引，None 对应空指针
+    std::vector<Vertex>* render_layers[] = { nullptr, &vertices_opaque, &vertices_transparent };
+
+    // 按存储顺序 (y, z, x) 遍历，使对打包方块数据的读取保持连续
+    for (int y = 0; y < WORLD_HEIGHT_IN_BLOCKS; ++y) {
+        if (skip_section[Chunk::sectionIndex(y)]) continue;
+        for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
+            for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
+                BlockType block_id = chunk.getBlock(x, y, z);
+                const BlockProperties& props = blockProperties(block_id);
+                std::vector<Vertex>* layer_vertices = render_layers[static_cast<int>(props.render_layer)];
+                if (!layer_vertices) continue;
 
                 glm::ivec3 block_pos_local(x, y, z);
-                glm::ivec3 block_pos_world = glm::ivec3(chunk_base_pos) + block_pos_local;
                 const glm::ivec3 neighbors[6] = {
                     {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
                 };
 
-                for (int i = 0; i < 6; ++i) {
-                    glm::ivec3 neighbor_world_pos = block_pos_world + neighbors[i];
-                    BlockType neighbor_id = static_cast<BlockType>(getBlock(neighbor_world_pos));
-                    bool is_neighbor_transparent = (neighbor_id == BlockType::Water || neighbor_id == BlockType::Air);
-
-                    bool should_draw_face = false;
-                    if (block_id == BlockType::Water) {
-                        if (neighbor_id != BlockType::Water) {
-                            should_draw_face = true;
-                        }
-                    } else {
-                        if (is_neighbor_transparent) {
-                            should_draw_face = true;
-                        }
-                    }
-
-                    if (should_draw_face) {
-                        int texture_index = 0;
-                        switch (block_id) {
-                        case BlockType::Stone: texture_index = Texture::Stone; break;
-                        case BlockType::Dirt:  texture_index = Texture::Dirt;  break;
-                        case BlockType::Grass:
-                            switch (i) {
-                            case 2:  texture_index = Texture::GrassTop; break;
-                            case 3:  texture_index = Texture::Dirt;     break;
-                            default: texture_index = Texture::GrassSide;break;
-                            }
-                            break;
-                        case BlockType::Water: texture_index = Texture::Water; break;
-                        default: continue;
-                        }
+                for (int i = 0; i < FACE_COUNT; ++i) {
+                    // 相邻体素可能落在相邻区块中，通过邻居链接读取，不需要查哈希表
+                    glm::ivec3 neighbor_local_pos = block_pos_local + neighbors[i];
+                    BlockType neighbor_id = chunk.getBlockRelative(neighbor_local_pos.x, neighbor_local_pos.y, neighbor_local_pos.z);
 
+                    if (isFaceVisible(block_id, neighbor_id)) {
+                        int texture_index = props.face_textures[i];
                         float u_offset = texture_index * Texture::TileWidth;
                         glm::vec3 block_pos_f = glm::vec3(block_pos_local);
 
-                        uint8_t light_val = getLight(neighbor_world_pos);
+                        uint8_t light_val = std::max(
+                            chunk.getSkyLightRelative(neighbor_local_pos.x, neighbor_local_pos.y, neighbor_local_pos.z),
+                            chunk.getBlockLightRelative(neighbor_local_pos.x, neighbor_local_pos.y, neighbor_local_pos.z));
                         float light_level = static_cast<float>(light_val) / 15.0f;
 
                         Vertex v[4];
@@ -1328,9 +1628,8 @@ void OpenGLWindow::buildChunkMesh(Chunk* chunk)
                         v[2] = { block_pos_f + face_vertices[i][2], { u_offset + Texture::TileWidth, 1.0f }, light_level };
                         v[3] = { block_pos_f + face_vertices[i][3], { u_offset, 1.0f }, light_level };
 
-                        if (block_id == BlockType::Water) {
-                            glm::ivec3 pos_above = block_pos_world + glm::ivec3(0, 1, 0);
-                            BlockType block_above = static_cast<BlockType>(getBlock(pos_above));
+                        if (props.liquid) {
+                            BlockType block_above = chunk.getBlockRelative(x, y + 1, z);
 
                             if (block_above == BlockType::Air) {
                                 for(int k = 0; k < 4; ++k) {
@@ -1341,22 +1640,22 @@ void OpenGLWindow::buildChunkMesh(Chunk* chunk)
                             }
                         }
 
-                        if (block_id == BlockType::Water) {
-                            vertices_transparent.push_back(v[0]); vertices_transparent.push_back(v[1]); vertices_transparent.push_back(v[2]);
-                            vertices_transparent.push_back(v[0]); vertices_transparent.push_back(v[2]); vertices_transparent.push_back(v[3]);
-                        } else {
-                            vertices_opaque.push_back(v[0]); vertices_opaque.push_back(v[1]); vertices_opaque.push_back(v[2]);
-                            vertices_opaque.push_back(v[0]); vertices_opaque.push_back(v[2]); vertices_opaque.push_back(v[3]);
-                        }
+                        layer_vertices->push_back(v[0]); layer_vertices->push_back(v[1]); layer_vertices->push_back(v[2]);
+                        layer_vertices->push_back(v[0]); layer_vertices->push_back(v[2]); layer_vertices->push_back(v[3]);
                     }
                 }
             }
         }
     }
 
-    chunk->mesh_data = std::move(vertices_opaque);
-    chunk->mesh_data_transparent = std::move(vertices_transparent);
-    m_ready_chunks_mutex.lock();
-    m_ready_chunks.append(chunk);
-    m_ready_chunks_mutex.unlock();
+    ChunkMesh mesh;
+    mesh.coords = chunk.coords();
+    mesh.chunk = chunk_ptr;
+    mesh.insert_sequence = insert_sequence;
+    mesh.build_serial = build_serial;
+    mesh.opaque = std::move(vertices_opaque);
+    mesh.transparent = std::move(vertices_transparent);
+    m_ready_meshes_mutex.lock();
+    m_ready_meshes.push_back(std::move(mesh));
+    m_ready_meshes_mutex.unlock();
 }
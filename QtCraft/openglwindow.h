@@ -17,17 +17,33 @@
 #include <memory>
 #include <map>
 #include <queue>
+#include <set>
+#include <limits>
 
 #include <QtConcurrent/QtConcurrent>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QMutex>
+#include <QThread>
 #include <QList>
 #include <QElapsedTimer>
 
-#include "FastNoiseLite.h"
 #include "camera.h"
 #include "block.h"
+#include "chunk.h"
+#include "chunkcache.h"
+#include "chunkmap.h"
+#include "chunkioservice.h"
+#include "chunkpool.h"
+#include "chunkscheduler.h"
+#include "chunkstorage.h"
+#include "chunksnapshot.h"
+#include "editjournal.h"
+#include "sectionstore.h"
+#include "skylight.h"
+#include "terraingenerator.h"
+#include "worldsettings.h"
+#include "worldview.h"
 #include "inventory.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -36,50 +52,11 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/hash.hpp>
 
-// 定义世界和区块的维度常量
-const int CHUNK_SIZE_XZ = 16;
-const int WORLD_HEIGHT_IN_BLOCKS = 128; // 一个区块柱的完整高度
-
-class Chunk {
-public:
-    // 为了方便，保留了旧的常量名，但建议使用新的常量
-    static const int CHUNK_SIZE = CHUNK_SIZE_XZ;
-    static const int CHUNK_HEIGHT = WORLD_HEIGHT_IN_BLOCKS;
-
-    Chunk();
-    ~Chunk();
-
-    QOpenGLVertexArrayObject vao;
-    QOpenGLBuffer vbo;
-    int vertex_count = 0;
-    std::vector<Vertex> mesh_data;
-
-    QOpenGLVertexArrayObject vao_transparent;
-    QOpenGLBuffer vbo_transparent;
-    int vertex_count_transparent = 0;
-    std::vector<Vertex> mesh_data_transparent;
-
-    // 区块现在存储一个完整的方块柱
-    uint8_t blocks[CHUNK_SIZE_XZ][WORLD_HEIGHT_IN_BLOCKS][CHUNK_SIZE_XZ] = {{{0}}};
-    uint8_t lighting[CHUNK_SIZE_XZ][WORLD_HEIGHT_IN_BLOCKS][CHUNK_SIZE_XZ] = {{{0}}};
-    bool needs_remeshing = true;
-
-    bool is_building = false;
-    glm::ivec3 coords; // y分量将始终为0，代表区块柱的基底
-};
-
 struct AABB {
     glm::vec3 min;
     glm::vec3 max;
 };
 
-// --- 新增：定义光照更新节点结构体 ---
-// 用于在洪水填充算法中传递方块位置和光照等级，比 std::pair 更清晰
-struct LightNode {
-    glm::ivec3 pos;
-    uint8_t level;
-};
-
 class OpenGLWindow : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
     Q_OBJECT
@@ -88,6 +65,38 @@ public:
     explicit OpenGLWindow(QWidget *parent = nullptr);
     ~OpenGLWindow();
 
+    // 流式加载半径（区块数）：玩家所在区块周围 load_radius 内的区块会被生成，
+    // 超出 unload_radius 的区块被卸载。unload_radius 大于 load_radius，
+    // 在边界附近来回走动时不会反复加载、卸载同一批区块。
+    void setStreamingRadii(int load_radius, int unload_radius);
+
+    // 内存预算（字节），覆盖方块、光照、CPU 端网格、显存中的顶点缓冲和压缩缓存，0 表示不限制。
+    // 超出时先收缩压缩缓存，再逐步缩小视距，让最远的区块被卸载；
+    // 用量回落到预算的 80% 以下后视距逐步恢复到 setStreamingRadii 设定的值。
+    void setMemoryBudget(size_t bytes);
+
+    struct MemoryStats {
+        size_t block_bytes = 0;
+        size_t light_bytes = 0;
+        size_t mesh_cpu_bytes = 0; // 已构建、等待上传的网格
+        size_t mesh_gpu_bytes = 0; // 显存中的顶点缓冲
+        size_t cache_bytes = 0;    // 压缩缓存
+        size_t chunk_bytes = 0;    // 对象池中的区块对象，包括空闲区块和备用子区块保留的缓冲区
+        size_t budget = 0;
+        int loaded_chunks = 0;
+        int cached_chunks = 0;
+        int load_radius = 0;       // 当前实际的加载半径，受预算限制时小于设定值
+
+        size_t total() const {
+            return block_bytes + light_bytes + mesh_cpu_bytes + mesh_gpu_bytes + cache_bytes + chunk_bytes;
+        }
+    };
+    // 当前内存用量，只能在 GUI 线程调用
+    MemoryStats memoryStats();
+
+    // 新建存档时使用的世界种子，必须在窗口显示之前调用。已有存档总是沿用它记录的种子
+    void setWorldSeed(int seed);
+
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
@@ -103,32 +112,50 @@ private slots:
     void handleChunkMeshReady();
 
 private:
-    // --- 光照系统成员变量和函数修改 ---
-    std::queue<LightNode> m_light_propagation_queue; // 更新队列类型为 LightNode
-    // m_light_removal_queue 已被移除，因为光照移除现在是 setBlock 中的局部操作
-
-    // 新增私有函数，用于即时光照更新
-    void removeLight(std::queue<LightNode>& removal_queue);
-    void propagateLight(std::queue<LightNode>& propagation_queue);
-    // ------------------------------------
-
-    void generateWorld();
-    void generateChunk(Chunk* chunk, const glm::ivec3& chunk_coords);
+    uint64_t m_insert_sequence = 0;          // 最近插入的区块的序号
+    uint64_t m_light_settled_sequence = 0;   // 天空光队列最近一次清空时的 m_insert_sequence
+
+    void generateSpawnArea();
+    // 按当前窗口尺寸和摄像机位置更新视锥，返回视图投影矩阵
+    glm::mat4 updateCameraFrustum();
+    // 同步地先尝试从存档读取，没有存档时生成；返回 true 表示来自存档。只用于启动时
+    bool loadOrGenerateChunk(Chunk* chunk);
+    void generateChunkAsync(Chunk* chunk);
+    void decodeCachedChunkAsync(Chunk* chunk, ChunkCache::Entry entry);
+    Chunk* addChunk(ChunkMap::ChunkPtr chunk);
+    void updateChunkStreaming();
+    void releaseChunkMesh(Chunk* chunk);
+    // 提交保存并把区块记为已保存，读写队列已满时返回 false
+    bool saveChunk(Chunk* chunk, int priority);
+    void runAutosave();
+    // 上一轮自动保存提交的保存都已完成时结束检查点并返回 true
+    bool completeCheckpoint();
+    // 在存档上重放上次运行留下的方块修改日志，必须在加载任何区块之前调用
+    void recoverEditJournal();
+    void enforceMemoryBudget();
     uint8_t getBlock(const glm::ivec3& world_pos);
     void setBlock(const glm::ivec3& world_pos, BlockType block_id);
     glm::ivec3 worldToChunkCoords(const glm::ivec3& world_pos);
-    void buildChunkMesh(Chunk* chunk);
+    // 在主线程取快照并派发网格任务
+    void dispatchChunkMesh(Chunk* chunk);
+    void buildChunkMesh(std::shared_ptr<const ChunkSnapshot> snapshot, const Chunk* chunk, uint64_t insert_sequence, uint64_t build_serial);
+    void uploadChunkMesh(Chunk* chunk, const std::vector<Vertex>& opaque, const std::vector<Vertex>& transparent);
     void processInput();
     void updatePhysics(float deltaTime);
     void resolveCollisions(glm::vec3& position, const glm::vec3& velocity);
+    WorldView collisionView(const AABB& box) const;
     AABB getPlayerAABB(const glm::vec3& position) const;
     bool raycast(glm::ivec3& hit_block, glm::ivec3& adjacent_block);
     void initShaders();
     int findSafeSpawnY(int x, int z);
 
-    void initializeSunlight();
-    uint8_t getLight(const glm::ivec3& world_pos);
-    void setLight(const glm::ivec3& world_pos, uint8_t level);
+    // 区块的光照是否已经传播完毕，此时可以随方块一起保存
+    bool isLightSettled(const Chunk* chunk) const;
+    bool isSectionHidden(const ChunkSnapshot& snapshot, int section_index);
+    // 光照访问：天空光和方块光分别存储在同一字节的两个半字节中
+    Chunk* findChunkForBlock(const glm::ivec3& world_pos, glm::ivec3& local_pos);
+    uint8_t getBlockLight(const glm::ivec3& world_pos);
+    void setBlockLight(const glm::ivec3& world_pos, uint8_t level);
 
     void initTextures();
     void initCrosshair();
@@ -137,7 +164,17 @@ private:
 
     QOpenGLShaderProgram m_program;
     QOpenGLTexture *m_texture_atlas = nullptr;
-    std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>> m_chunks;
+    ChunkPool m_chunk_pool; // 必须在 m_chunks 之前声明，保证区块先归还再析构对象池
+    ChunkMap m_chunks;
+    SkyLight m_sky_light; // 必须在 m_chunks 之后声明
+    SectionStore m_section_store;
+    TerrainGenerator m_terrain;
+    bool m_has_requested_seed = false;
+    int m_requested_seed = 0;
+    ChunkStorage m_chunk_storage;
+    ChunkIOService m_chunk_io; // 必须在 m_chunk_storage 之后声明，先停止读写再关闭文件
+    ChunkCache m_chunk_cache;
+    EditJournal m_journal; // 必须在 m_chunk_storage 之后声明，检查点要刷新区域文件
     GLint m_vp_matrix_location;
     GLint m_model_matrix_location;
     QTimer m_timer;
@@ -164,6 +201,7 @@ private:
     GLint m_overlay_color_location;
 
     Camera m_camera;
+    ChunkScheduler m_scheduler;
     Inventory m_inventory;
     glm::vec3 m_player_velocity = glm::vec3(0.0f);
     bool m_is_on_ground = false;
@@ -178,9 +216,54 @@ private:
     bool m_cursor_locked = false;
     bool m_just_locked_cursor = false;
 
+    // 流式加载：正在读档或后台生成的区块按打包坐标保存，完成后由主线程插入 m_chunks
+    int m_load_radius;
+    int m_unload_radius;
+    // 内存预算：m_max_load_radius 是设定的加载半径，m_load_radius 在超出预算时会临时缩小，
+    // 卸载半径始终比加载半径大 m_unload_margin
+    size_t m_memory_budget = 0;
+    int m_max_load_radius;
+    int m_unload_margin;
+    QElapsedTimer m_budget_timer; // 限制视距调整的频率
+
+    // 增量自动保存：定时把有未保存修改的区块交给读写服务，队列满时分几帧提交
+    QElapsedTimer m_autosave_timer;
+    bool m_autosave_running = false;
+    int m_autosave_written = 0;
+    // 每轮自动保存同时是修改日志的检查点：开始时切换日志段，此前和本轮提交的保存全部成功后删除旧日志段。
+    // 保存按提交顺序编号，m_saves_in_flight 是还没有完成的编号
+    uint64_t m_save_ticket = 0;
+    std::set<uint64_t> m_saves_in_flight;
+    int m_checkpoint_segment = -1;     // 进行中的检查点要删除的日志段，-1 表示没有
+    uint64_t m_checkpoint_barrier = 0; // 编号不超过它的保存都完成后检查点才算完成
+    bool m_checkpoint_failed = false;
+    bool m_journal_pinned = false;     // 已卸载区块的保存失败过，修改只剩日志中有，本次运行不再删除日志
+    bool m_journal_write_failing = false; // 日志有批次写入失败、只在内存中等待重试
+    // 启动耗时：从窗口创建开始计时，报告首帧和视距填满的时间
+    QElapsedTimer m_startup_timer;
+    bool m_first_frame_reported = false;
+    bool m_view_filled_reported = false;
+    std::unordered_map<uint64_t, ChunkMap::ChunkPtr> m_generating_chunks;
+    QMutex m_generated_chunks_mutex;
+    std::vector<uint64_t> m_generated_chunks;
+
     QFutureWatcher<void> m_mesh_builder_watcher;
-    QMutex m_ready_chunks_mutex;
-    QList<Chunk*> m_ready_chunks;
+    // 后台构建完成的网格按区块坐标回传，主线程再查找区块上传。
+    // 区块在构建期间被卸载、又重新加载进来时，对象池可能分配到同一个 Chunk，
+    // 所以连同插入序号和构建序号一起核对，不一致的结果直接丢弃
+    struct ChunkMesh {
+        glm::ivec3 coords;
+        const Chunk* chunk = nullptr; // 只用于比较，不解引用
+        uint64_t insert_sequence = 0;
+        uint64_t build_serial = 0;
+        std::vector<Vertex> opaque;
+        std::vector<Vertex> transparent;
+    };
+    // 回传的网格是否属于 mesh.coords 处当前区块的最近一次构建
+    Chunk* currentMeshTarget(const ChunkMesh& mesh) const;
+    QMutex m_ready_meshes_mutex;
+    std::vector<ChunkMesh> m_ready_meshes;
+    int m_meshes_in_flight = 0; // 已派发、结果还没取回的网格任务数
 };
 
 #endif // OPENGLWINDOW_H
@@ -0,0 +1,323 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "chunk.h"
+#include "chunkmap.h"
+#include "chunkpool.h"
+#include "chunkserializer.h"
+#include "chunkstorage.h"
+#include "fnv1a.h"
+#include "regionfile.h"
+#include "skylight.h"
+#include "terraingenerator.h"
+#include "worldsettings.h"
+
+// 世界预生成工具：pregen [--world <目录>] [--threads <n>] [--seed <n>] [--force] [--raw] [--verify] <x0> <z0> <x1> <z1>
+// 生成区块坐标 [x0, x1] x [z0, z1]（含两端）内的全部区块柱，连同算好的天空光以游戏的存档格式写入，
+// 游戏读入后不必重新计算光照。
+// 矩形按行分成若干条带依次处理：条带中的区块柱在全局线程池的所有线程上并行生成，
+// 在主线程上插入 ChunkMap 并用游戏的天空光代码（SkyLight）传播光照，再并行编码、压缩和写入。
+// 光照需要相邻区块，所以矩形左右两侧和条带上下各多准备一圈区块；下一个条带接着使用
+// 已经在内存中的相邻行，每个区块柱只生成一次。
+// 存档中已有的区块柱（例如玩家修改过的）默认不覆盖，只读出来作为相邻区块参与光照；
+// --force 时矩形内的区块柱全部重新生成并覆盖。
+// --raw 把存档切换为不压缩保存（记录在 world.ini 中，游戏之后写入的区块也不压缩），
+// 游戏在映射模式下直接解码映射内存，适合在预生成好的大世界里快速移动视角。
+// 结束时打印整个矩形的世界指纹：同一种子、同一矩形的指纹与线程数和生成顺序无关，
+// 可以在不同机器、不同版本之间直接比较。--verify 再在主线程上逐个重新生成本次写入的区块柱
+// （参考路径），并从存档读回，确认三者逐方块一致。
+namespace {
+const qint64 PROGRESS_INTERVAL_MS = 1000;
+const int MAX_REPORTED_MISMATCHES = 8;
+// 每个条带大约包含的区块柱数，决定同时驻留内存的区块数
+const int BAND_TARGET_COLUMNS = 1024;
+
+// 把区块柱坐标和它的内容指纹（Chunk::contentHash）依次折叠进世界指纹
+uint64_t worldFingerprint(const std::vector<glm::ivec3>& columns, const std::vector<uint64_t>& hashes)
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        hash = fnv1a(hash, (static_cast<uint64_t>(static_cast<uint32_t>(columns[i].x)) << 32) |
+                               static_cast<uint32_t>(columns[i].z));
+        hash = fnv1a(hash, hashes[i]);
+    }
+    return hash;
+}
+
+uint64_t regionKey(const glm::ivec3& coords)
+{
+    const int region_x = RegionFile::regionCoord(coords.x);
+    const int region_z = RegionFile::regionCoord(coords.z);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(region_x)) << 32) | static_cast<uint32_t>(region_z);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("pregen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("预先生成一块矩形区域内的区块并写入存档，坐标以区块为单位，包含两端。");
+    parser.addHelpOption();
+    const QCommandLineOption world_option(QStringList() << "w" << "world", "存档目录，默认为 world。", "dir", "world");
+    const QCommandLineOption threads_option(QStringList() << "j" << "threads", "工作线程数，默认使用全部核心。", "n");
+    const QCommandLineOption seed_option(QStringList() << "s" << "seed", "新建存档时使用的世界种子，已有存档沿用记录的种子。", "n");
+    const QCommandLineOption force_option("force", "重新生成并覆盖存档中已有的区块柱，包括玩家修改过的。");
+    const QCommandLineOption raw_option("raw", "不压缩保存区块，并记录在存档中：磁盘占用变大，游戏读取时不再解压。");
+    const QCommandLineOption verify_option("verify", "生成后在单线程上重新生成并读回存档，逐区块比较指纹。");
+    parser.addOption(world_option);
+    parser.addOption(threads_option);
+    parser.addOption(seed_option);
+    parser.addOption(force_option);
+    parser.addOption(raw_option);
+    parser.addOption(verify_option);
+    parser.addPositionalArgument("x0", "矩形一角的区块 x 坐标。");
+    parser.addPositionalArgument("z0", "矩形一角的区块 z 坐标。");
+    parser.addPositionalArgument("x1", "对角的区块 x 坐标。");
+    parser.addPositionalArgument("z1", "对角的区块 z 坐标。");
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 4) {
+        std::fprintf(stderr, "需要 4 个坐标参数。\n");
+        parser.showHelp(1);
+    }
+    int corners[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        corners[i] = args[i].toInt(&ok);
+        if (!ok) {
+            std::fprintf(stderr, "无效的坐标：%s\n", qPrintable(args[i]));
+            return 1;
+        }
+    }
+    if (parser.isSet(threads_option)) {
+        bool ok = false;
+        const int threads = parser.value(threads_option).toInt(&ok);
+        if (!ok || threads <= 0) {
+            std::fprintf(stderr, "无效的线程数：%s\n", qPrintable(parser.value(threads_option)));
+            return 1;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+    int requested_seed = 0;
+    if (parser.isSet(seed_option)) {
+        bool ok = false;
+        requested_seed = parser.value(seed_option).toInt(&ok);
+        if (!ok) {
+            std::fprintf(stderr, "无效的种子：%s\n", qPrintable(parser.value(seed_option)));
+            return 1;
+        }
+    }
+
+    const int x0 = std::min(corners[0], corners[2]), x1 = std::max(corners[0], corners[2]);
+    const int z0 = std::min(corners[1], corners[3]), z1 = std::max(corners[1], corners[3]);
+    std::vector<glm::ivec3> columns;
+    columns.reserve(static_cast<size_t>(x1 - x0 + 1) * static_cast<size_t>(z1 - z0 + 1));
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            columns.push_back(glm::ivec3(x, 0, z));
+        }
+    }
+
+    // 同一区域文件同一时间只能有一个线程读写（见 ChunkStorage），每个区域一把锁，
+    // 锁表在开始前建好，之后只读；不同区域的读写、压缩可以同时进行。
+    // 作为相邻区块读取的外圈区块柱也要加锁
+    const int prepared_x0 = x0 - 1, prepared_x1 = x1 + 1;
+    std::map<uint64_t, std::unique_ptr<QMutex>> region_locks;
+    for (int z = z0 - 1; z <= z1 + 1; ++z) {
+        for (int x = prepared_x0; x <= prepared_x1; ++x) {
+            std::unique_ptr<QMutex>& lock = region_locks[regionKey(glm::ivec3(x, 0, z))];
+            if (!lock) lock.reset(new QMutex);
+        }
+    }
+
+    const QString directory = parser.value(world_option);
+    if (parser.isSet(raw_option)) WorldSettings::setRawChunks(directory, true);
+    const bool raw = parser.isSet(raw_option) || WorldSettings::rawChunks(directory);
+    ChunkStorage storage(directory, RegionFile::ReadMode::Mapped, !raw);
+    const TerrainGenerator terrain(WorldSettings::resolveSeed(directory, parser.isSet(seed_option), requested_seed));
+    const bool force = parser.isSet(force_option);
+    const int width = x1 - x0 + 1;
+    const auto inRectangle = [&](const glm::ivec3& coords) {
+        return coords.x >= x0 && coords.x <= x1 && coords.z >= z0 && coords.z <= z1;
+    };
+    const auto columnIndex = [&](const glm::ivec3& coords) {
+        return static_cast<size_t>(coords.z - z0) * width + (coords.x - x0);
+    };
+
+    // 开始前记下存档中已有的区块柱，本次运行写入的区块柱不算在内
+    std::unordered_set<uint64_t> stored;
+    for (int z = z0 - 1; z <= z1 + 1; ++z) {
+        for (int x = prepared_x0; x <= prepared_x1; ++x) {
+            if (storage.hasChunk(glm::ivec3(x, 0, z))) stored.insert(ChunkMap::packKey(x, z));
+        }
+    }
+
+    // 按行优先的下标存放每个区块柱的指纹，各任务只写自己的那一项
+    std::vector<uint64_t> hashes(columns.size(), 0);
+    std::vector<char> kept(columns.size(), 0); // 保留了存档中的数据，不写入
+    std::atomic<int> failed(0);
+    std::atomic<int> corrupted(0);
+
+    const int total = static_cast<int>(columns.size());
+    std::printf("生成 [%d, %d] x [%d, %d] 共 %d 个区块柱，%d 个区域文件，%d 个线程，种子 %d%s。\n",
+                x0, x1, z0, z1, total, static_cast<int>(region_locks.size()),
+                QThreadPool::globalInstance()->maxThreadCount(), terrain.seed(), raw ? "，不压缩" : "");
+    std::fflush(stdout);
+
+    // 区块对象池、索引和光照只在主线程上使用，工作线程只填充已经取出的区块
+    ChunkPool pool;
+    ChunkMap chunks;
+    SkyLight sky_light(chunks);
+    const int band_rows = std::max(1, BAND_TARGET_COLUMNS / (prepared_x1 - prepared_x0 + 1));
+    int prepared_z1 = z0 - 2; // 已经插入 chunks 的最后一行
+    int done = 0;
+    int skipped = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    int reported = 0;
+    qint64 reported_ms = 0;
+    for (int band_z0 = z0; band_z0 <= z1; band_z0 += band_rows) {
+        const int band_z1 = std::min(band_z0 + band_rows - 1, z1);
+
+        // 准备条带及其下一行的区块：存档中已有、不被覆盖的读出来，其余的生成
+        std::vector<ChunkMap::ChunkPtr> prepared;
+        for (int z = prepared_z1 + 1; z <= band_z1 + 1; ++z) {
+            for (int x = prepared_x0; x <= prepared_x1; ++x) {
+                ChunkMap::ChunkPtr chunk = pool.acquire();
+                chunk->coords = glm::ivec3(x, 0, z);
+                prepared.push_back(std::move(chunk));
+            }
+        }
+        prepared_z1 = band_z1 + 1;
+        QtConcurrent::blockingMap(prepared, [&](ChunkMap::ChunkPtr& chunk) {
+            const bool keep = stored.count(ChunkMap::packKey(chunk->coords.x, chunk->coords.z)) &&
+                              !(force && inRectangle(chunk->coords));
+            if (keep) {
+                QMutex* lock = region_locks.at(regionKey(chunk->coords)).get();
+                lock->lock();
+                const bool loaded = storage.loadChunk(*chunk);
+                lock->unlock();
+                if (loaded) {
+                    if (inRectangle(chunk->coords)) kept[columnIndex(chunk->coords)] = 1;
+                    return;
+                }
+                // 数据损坏，loadChunk 已经重置了区块，重新生成；矩形内的会在下面写回
+                ++corrupted;
+            }
+            terrain.generate(*chunk);
+        });
+
+        // 按行优先插入并初始化天空光，然后传播到底。条带的每个区块此时都有完整的相邻区块，
+        // 光照不会再变；下一行还缺相邻区块，留到下一个条带继续
+        for (ChunkMap::ChunkPtr& chunk : prepared) {
+            sky_light.initializeChunk(chunks.insert(std::move(chunk)));
+        }
+        sky_light.propagate();
+
+        // 写入条带中新生成的区块柱，已有的只记录指纹
+        std::vector<Chunk*> band;
+        for (int z = band_z0; z <= band_z1; ++z) {
+            for (int x = x0; x <= x1; ++x) {
+                band.push_back(chunks.find(x, z));
+            }
+        }
+        QtConcurrent::blockingMap(band, [&](Chunk* chunk) {
+            const size_t index = columnIndex(chunk->coords);
+            hashes[index] = chunk->contentHash();
+            if (kept[index]) return;
+            const QByteArray data = ChunkSerializer::serialize(*chunk, ChunkSerializer::Light::Settled);
+
+            QMutex* lock = region_locks.at(regionKey(chunk->coords)).get();
+            lock->lock();
+            const bool saved = storage.saveData(chunk->coords, data);
+            lock->unlock();
+            if (!saved) ++failed;
+        });
+        for (const Chunk* chunk : band) {
+            if (kept[columnIndex(chunk->coords)]) ++skipped;
+        }
+        done += static_cast<int>(band.size());
+
+        // 条带最后一行留作下一个条带的相邻行，之前的行不再需要
+        for (int z = band_z0 - 1; z < band_z1; ++z) {
+            for (int x = prepared_x0; x <= prepared_x1; ++x) {
+                chunks.remove(x, z);
+            }
+        }
+
+        const qint64 now_ms = timer.elapsed();
+        if (now_ms - reported_ms < PROGRESS_INTERVAL_MS && band_z1 < z1) continue;
+        std::printf("%d / %d（%.1f%%），%.0f 区块/秒\n", done, total, 100.0 * done / std::max(total, 1),
+                    (done - reported) * 1000.0 / std::max<qint64>(now_ms - reported_ms, 1));
+        std::fflush(stdout);
+        reported = done;
+        reported_ms = now_ms;
+    }
+
+    // 退出前把区域文件刷到磁盘，工具返回时存档一定是完整的
+    if (!storage.sync()) std::fprintf(stderr, "区域文件刷盘失败。\n");
+
+    const double seconds = std::max(timer.nsecsElapsed() / 1e9, 1e-9);
+    const ChunkStorage::Stats stats = storage.stats();
+    std::printf("完成：%d 个区块柱，用时 %.2f 秒，平均 %.0f 区块/秒，写入 %.1f MiB（压缩前）。\n",
+                stats.chunks_saved, seconds, stats.chunks_saved / seconds, stats.bytes_written / (1024.0 * 1024.0));
+    if (skipped > 0) {
+        std::printf("保留了存档中已有的 %d 个区块柱，需要覆盖时使用 --force。\n", skipped);
+    }
+    if (corrupted.load() > 0) {
+        std::fprintf(stderr, "%d 个区块柱的存档数据损坏，已重新生成。\n", corrupted.load());
+    }
+    std::printf("世界指纹：%016llx（种子 %d）\n", static_cast<unsigned long long>(worldFingerprint(columns, hashes)), terrain.seed());
+    if (failed.load() > 0) {
+        std::fprintf(stderr, "%d 个区块写入失败。\n", failed.load());
+        return 1;
+    }
+
+    if (parser.isSet(verify_option)) {
+        std::fflush(stdout);
+        int mismatches = 0;
+        for (size_t i = 0; i < columns.size(); ++i) {
+            // 保留下来的区块柱可能被玩家修改过，不和参考生成比较
+            if (kept[i]) continue;
+            Chunk reference;
+            reference.coords = columns[i];
+            terrain.generate(reference);
+            const uint64_t expected = reference.contentHash();
+
+            Chunk stored;
+            stored.coords = columns[i];
+            const bool loaded = storage.loadChunk(stored);
+            const uint64_t stored_hash = loaded ? stored.contentHash() : 0;
+            if (hashes[i] == expected && loaded && stored_hash == expected) continue;
+
+            if (++mismatches <= MAX_REPORTED_MISMATCHES) {
+                std::fprintf(stderr, "区块柱 (%d, %d) 不一致：参考 %016llx，并行 %016llx，存档 %016llx%s\n",
+                             columns[i].x, columns[i].z, static_cast<unsigned long long>(expected),
+                             static_cast<unsigned long long>(hashes[i]), static_cast<unsigned long long>(stored_hash),
+                             loaded ? "" : "（无法读取）");
+            }
+        }
+        if (mismatches > 0) {
+            std::fprintf(stderr, "校验失败：%d / %d 个区块柱不一致。\n", mismatches, total - skipped);
+            return 2;
+        }
+        std::printf("校验通过：%d 个区块柱的参考生成、并行生成和存档内容一致。\n", total - skipped);
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+# 无界面的世界预生成工具：在所有核心上生成一块矩形区域内的区块，计算天空光后写入游戏使用的存档格式。
+# Chunk 带有 GL 缓冲对象成员，需要链接 gui 模块；工具只创建 QCoreApplication，
+# 不加载平台插件，也从不创建 GL 上下文，可以在没有显示器和 GPU 的构建服务器上运行。
+TEMPLATE = app
+TARGET = pregen
+CONFIG += console c++17
+CONFIG -= app_bundle
+QT += core gui opengl concurrent
+
+INCLUDEPATH += $$PWD/.. $$PWD/../glm
+
+SOURCES += \
+    ../blockstatestorage.cpp \
+    ../blockstorage.cpp \
+    ../chunk.cpp \
+    ../chunkmap.cpp \
+    ../chunkpool.cpp \
+    ../chunkserializer.cpp \
+    ../chunkstorage.cpp \
+    ../lightstorage.cpp \
+    ../regionfile.cpp \
+    ../sectionstore.cpp \
+    ../skylight.cpp \
+    ../terraingenerator.cpp \
+    ../worldsettings.cpp \
+    pregen.cpp
+
+HEADERS += \
+    ../FastNoiseLite.h \
+    ../block.h \
+    ../blockstatestorage.h \
+    ../blockstorage.h \
+    ../chunk.h \
+    ../chunkmap.h \
+    ../chunkpool.h \
+    ../chunksection.h \
+    ../chunkserializer.h \
+    ../chunkstorage.h \
+    ../fnv1a.h \
+    ../lightstorage.h \
+    ../regionfile.h \
+    ../sectionstore.h \
+    ../skylight.h \
+    ../terraingenerator.h \
+    ../worldsettings.h
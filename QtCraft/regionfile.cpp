@@ -0,0 +1,315 @@
+#include "regionfile.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const uint32_t REGION_MAGIC = 0x47524351; // "QCRG"
+// 第 2 版允许未压缩数据。第 1 版的文件照常读取，第一次写入未压缩数据时才把版本号升级
+const uint32_t REGION_VERSION = 2;
+const uint32_t REGION_VERSION_COMPRESSED_ONLY = 1;
+const int HEADER_PREFIX_SIZE = 8; // 魔数 + 版本
+const int ENTRY_SIZE = 8;
+const int HEADER_SIZE = HEADER_PREFIX_SIZE + RegionFile::CHUNKS_PER_REGION * ENTRY_SIZE;
+const uint32_t HEADER_SECTORS = (HEADER_SIZE + RegionFile::SECTOR_SIZE - 1) / RegionFile::SECTOR_SIZE;
+// 偏移表中长度的最高位表示数据未压缩（第 2 版起），第 1 版文件中这一位总是 0
+const uint32_t RAW_LENGTH_FLAG = 0x80000000u;
+}
+
+QString RegionFile::fileName(int region_x, int region_z)
+{
+    return QString("r.%1.%2.region").arg(region_x).arg(region_z);
+}
+
+RegionFile::RegionFile(const QString& path, ReadMode mode)
+    : m_file(path)
+    , m_read_mode(mode)
+{
+}
+
+RegionFile::~RegionFile()
+{
+    unmap();
+    if (m_file.isOpen()) m_file.close();
+}
+
+bool RegionFile::open()
+{
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开区域文件" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+
+    if (m_file.size() == 0) {
+        // 新文件：写入空文件头，整个文件头占满若干扇区
+        QByteArray header(HEADER_SECTORS * SECTOR_SIZE, '\0');
+        uint32_t magic = qToLittleEndian(REGION_MAGIC);
+        uint32_t version = qToLittleEndian(REGION_VERSION);
+        std::memcpy(header.data(), &magic, 4);
+        std::memcpy(header.data() + 4, &version, 4);
+        if (m_file.write(header) != header.size()) {
+            qWarning() << "无法初始化区域文件" << m_file.fileName();
+            m_file.close();
+            return false;
+        }
+        m_file.flush();
+        m_version = REGION_VERSION;
+        for (Entry& entry : m_entries) entry = Entry();
+        m_sector_used.assign(HEADER_SECTORS, true);
+        return true;
+    }
+
+    QByteArray header = m_file.read(HEADER_SIZE);
+    uint32_t magic = 0, version = 0;
+    if (header.size() == HEADER_SIZE) {
+        std::memcpy(&magic, header.constData(), 4);
+        std::memcpy(&version, header.constData() + 4, 4);
+    }
+    m_version = qFromLittleEndian(version);
+    if (qFromLittleEndian(magic) != REGION_MAGIC ||
+        (m_version != REGION_VERSION && m_version != REGION_VERSION_COMPRESSED_ONLY)) {
+        qWarning() << "区域文件头无效" << m_file.fileName();
+        m_file.close();
+        return false;
+    }
+
+    const uint32_t total_sectors = static_cast<uint32_t>((m_file.size() + SECTOR_SIZE - 1) / SECTOR_SIZE);
+    m_sector_used.assign(total_sectors, false);
+    markSectors(0, HEADER_SECTORS, true);
+
+    for (int i = 0; i < CHUNKS_PER_REGION; ++i) {
+        uint32_t raw[2];
+        std::memcpy(raw, header.constData() + HEADER_PREFIX_SIZE + i * ENTRY_SIZE, ENTRY_SIZE);
+        Entry entry;
+        entry.sector = qFromLittleEndian(raw[0]);
+        entry.length = qFromLittleEndian(raw[1]) & ~RAW_LENGTH_FLAG;
+        entry.raw = (qFromLittleEndian(raw[1]) & RAW_LENGTH_FLAG) != 0;
+        // 指向文件头或文件末尾之外的表项视为损坏，当作没有保存过。
+        // 损坏的起始扇区可能接近 UINT32_MAX，用 64 位计算末尾，避免回绕后通过检查
+        if (entry.length != 0 &&
+            (entry.sector < HEADER_SECTORS ||
+             static_cast<uint64_t>(entry.sector) + sectorsFor(entry.length) > total_sectors)) {
+            qWarning() << "区域文件" << m_file.fileName() << "中第" << i << "个区块的偏移无效，已忽略";
+            entry = Entry();
+        }
+        m_entries[i] = entry;
+        if (entry.length != 0) markSectors(entry.sector, sectorsFor(entry.length), true);
+    }
+    return true;
+}
+
+RegionFile::Payload RegionFile::read(int local_x, int local_z)
+{
+    Payload payload;
+    const Entry& entry = m_entries[entryIndex(local_x, local_z)];
+    if (entry.length == 0) return payload;
+
+    const qint64 offset = static_cast<qint64>(entry.sector) * SECTOR_SIZE;
+    const int length = static_cast<int>(entry.length);
+    if (m_read_mode == ReadMode::Mapped && ensureMapped(offset + length)) {
+        const uchar* stored = m_map + offset;
+        if (entry.raw) {
+            payload.data = reinterpret_cast<const char*>(stored);
+            payload.size = length;
+        } else {
+            payload.buffer = qUncompress(stored, length);
+        }
+    } else {
+        if (!m_file.seek(offset)) return payload;
+        QByteArray stored = m_file.read(length);
+        if (stored.size() != length) return payload;
+        payload.buffer = entry.raw ? stored : qUncompress(stored);
+    }
+
+    if (!payload.data && !payload.buffer.isEmpty()) {
+        payload.data = payload.buffer.constData();
+        payload.size = payload.buffer.size();
+    }
+    return payload;
+}
+
+void RegionFile::prefetch(int local_x, int local_z)
+{
+#ifdef Q_OS_UNIX
+    const Entry& entry = m_entries[entryIndex(local_x, local_z)];
+    if (entry.length == 0 || m_read_mode != ReadMode::Mapped) return;
+    const qint64 offset = static_cast<qint64>(entry.sector) * SECTOR_SIZE;
+    if (!ensureMapped(offset + entry.length)) return;
+    // madvise 的起始地址必须按页对齐，页可能大于扇区
+    static const qint64 page_size = sysconf(_SC_PAGESIZE);
+    const qint64 aligned = offset - offset % page_size;
+    madvise(m_map + aligned, static_cast<size_t>(offset + entry.length - aligned), MADV_WILLNEED);
+#else
+    Q_UNUSED(local_x);
+    Q_UNUSED(local_z);
+#endif
+}
+
+bool RegionFile::write(int local_x, int local_z, const QByteArray& data, bool compress)
+{
+    const int index = entryIndex(local_x, local_z);
+    const QByteArray compressed = compress ? qCompress(data) : data;
+    const uint32_t length = static_cast<uint32_t>(compressed.size());
+    if (length == 0 || (length & RAW_LENGTH_FLAG)) return false;
+    const uint32_t count = sectorsFor(length);
+
+    // 新数据写到空闲扇区并刷盘之后才更新偏移表，旧扇区等到下一次 sync() 之后才重新分配
+    reclaimSyncedSectors();
+    const Entry old_entry = m_entries[index];
+    const uint32_t first = allocateSectors(count);
+
+    // 补齐最后一个扇区，保证文件长度始终是扇区的整数倍
+    const int padding = static_cast<int>(count * SECTOR_SIZE - length);
+    if (!m_file.seek(static_cast<qint64>(first) * SECTOR_SIZE) ||
+        m_file.write(compressed) != compressed.size() ||
+        (padding > 0 && m_file.write(QByteArray(padding, '\0')) != padding) ||
+        !syncData()) {
+        qWarning() << "写入区域文件失败" << m_file.fileName() << m_file.errorString();
+        markSectors(first, count, false);
+        return false;
+    }
+
+    // 未压缩数据需要第 2 版的文件头，版本号与表项一起刷盘
+    if (!compress && m_version != REGION_VERSION) {
+        const uint32_t version = qToLittleEndian(REGION_VERSION);
+        if (!m_file.seek(4) || m_file.write(reinterpret_cast<const char*>(&version), 4) != 4) {
+            qWarning() << "升级区域文件版本失败" << m_file.fileName() << m_file.errorString();
+            markSectors(first, count, false);
+            return false;
+        }
+        m_version = REGION_VERSION;
+    }
+
+    m_entries[index].sector = first;
+    m_entries[index].length = length;
+    m_entries[index].raw = !compress;
+    if (!writeEntry(index) || !m_file.flush()) {
+        // 磁盘上的表项可能已经指向新扇区，新扇区保持占用，直到重新打开文件时按偏移表重建
+        qWarning() << "更新区域文件偏移表失败" << m_file.fileName() << m_file.errorString();
+        m_entries[index] = old_entry;
+        return false;
+    }
+
+    if (old_entry.length != 0) {
+        QMutexLocker locker(&m_freed_mutex);
+        m_freed_unsynced.emplace_back(old_entry.sector, sectorsFor(old_entry.length));
+    }
+    return true;
+}
+
+bool RegionFile::sync()
+{
+    if (!m_file.isOpen()) return false;
+
+    // 先取出已经写过新表项的旧扇区，刷盘成功后它们才可以重新分配
+    std::vector<std::pair<uint32_t, uint32_t>> freed;
+    m_freed_mutex.lock();
+    freed.swap(m_freed_unsynced);
+    m_freed_mutex.unlock();
+
+#ifdef Q_OS_UNIX
+    const bool ok = fsync(m_file.handle()) == 0;
+#else
+    const bool ok = true;
+#endif
+
+    QMutexLocker locker(&m_freed_mutex);
+    std::vector<std::pair<uint32_t, uint32_t>>& target = ok ? m_freed_synced : m_freed_unsynced;
+    target.insert(target.end(), freed.begin(), freed.end());
+    return ok;
+}
+
+bool RegionFile::syncData()
+{
+    if (!m_file.flush()) return false;
+#ifdef Q_OS_UNIX
+    return fsync(m_file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+void RegionFile::reclaimSyncedSectors()
+{
+    std::vector<std::pair<uint32_t, uint32_t>> freed;
+    m_freed_mutex.lock();
+    freed.swap(m_freed_synced);
+    m_freed_mutex.unlock();
+    for (const auto& run : freed) markSectors(run.first, run.second, false);
+}
+
+bool RegionFile::writeEntry(int index)
+{
+    const Entry& entry = m_entries[index];
+    uint32_t raw[2] = { qToLittleEndian(entry.sector), qToLittleEndian(entry.length | (entry.raw ? RAW_LENGTH_FLAG : 0)) };
+    if (!m_file.seek(HEADER_PREFIX_SIZE + static_cast<qint64>(index) * ENTRY_SIZE)) return false;
+    return m_file.write(reinterpret_cast<const char*>(raw), ENTRY_SIZE) == ENTRY_SIZE;
+}
+
+uint32_t RegionFile::allocateSectors(uint32_t count)
+{
+    // 首次适配；没有足够大的空洞时追加到文件末尾
+    uint32_t run_start = 0;
+    uint32_t run_length = 0;
+    for (uint32_t i = HEADER_SECTORS; i < m_sector_used.size(); ++i) {
+        if (m_sector_used[i]) {
+            run_length = 0;
+            continue;
+        }
+        if (run_length == 0) run_start = i;
+        if (++run_length == count) {
+            markSectors(run_start, count, true);
+            return run_start;
+        }
+    }
+
+    // 末尾的空闲扇区可以和新追加的扇区连在一起
+    const uint32_t first = (run_length > 0) ? run_start : static_cast<uint32_t>(m_sector_used.size());
+    if (first + count > m_sector_used.size()) m_sector_used.resize(first + count, false);
+    markSectors(first, count, true);
+    return first;
+}
+
+void RegionFile::markSectors(uint32_t first, uint32_t count, bool used)
+{
+    for (uint32_t i = first; i < first + count && i < m_sector_used.size(); ++i) {
+        m_sector_used[i] = used;
+    }
+}
+
+bool RegionFile::ensureMapped(qint64 end)
+{
+    if (end <= m_mapped_size) return true;
+
+    // 已映射范围内的覆盖写入通过共享映射直接可见，只有文件变长后才需要重新映射
+    unmap();
+    const qint64 size = m_file.size();
+    if (end > size) return false;
+    m_map = m_file.map(0, size);
+    if (!m_map) {
+        qWarning() << "无法映射区域文件" << m_file.fileName() << m_file.errorString() << "，改用缓冲读取";
+        m_read_mode = ReadMode::Buffered;
+        return false;
+    }
+    m_mapped_size = size;
+#ifdef Q_OS_UNIX
+    // 区块按玩家位置随机访问，关闭预读，避免把相邻的无关区块一起读进来
+    madvise(m_map, static_cast<size_t>(m_mapped_size), MADV_RANDOM);
+#endif
+    return true;
+}
+
+void RegionFile::unmap()
+{
+    if (!m_map) return;
+    m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapped_size = 0;
+}
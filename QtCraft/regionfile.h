@@ -0,0 +1,106 @@
+#ifndef REGIONFILE_H
+#define REGIONFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+// 区域文件：一个文件保存 32x32 个区块柱
+// 文件按 4 KiB 扇区组织。开头的文件头包含魔数、版本和 1024 项偏移表，
+// 每项记录一个区块的起始扇区和压缩后数据的字节数（0 表示还没有保存过）。
+// 区块数据用 qCompress 压缩后连续存放在若干扇区中，可以单独随机读写任意一个区块。
+// 写入总是先把数据写到空闲扇区并刷盘，再更新偏移表；被替换的旧扇区要等下一次 sync()
+// 把新的偏移表刷到磁盘之后才会重新分配。因此写到一半崩溃时，磁盘上的偏移表指向的
+// 要么是旧数据，要么是已经落盘的新数据。
+// 数据也可以不压缩直接存放（第 2 版起，偏移表中长度的最高位标记），映射模式下读取这样的区块
+// 不经过任何中间缓冲区，解码器直接读映射内存。
+// 不是线程安全的。
+class RegionFile {
+public:
+    static const int REGION_SHIFT = 5;
+    static const int REGION_SIZE = 1 << REGION_SHIFT; // 每个区域文件在 x、z 方向上各包含的区块数
+    static const int CHUNKS_PER_REGION = REGION_SIZE * REGION_SIZE;
+    static const int SECTOR_SIZE = 4096;
+
+    // 区块坐标 -> 区域坐标 / 区域内的局部坐标
+    static int regionCoord(int chunk_coord) { return chunk_coord >> REGION_SHIFT; }
+    static int localCoord(int chunk_coord) { return chunk_coord & (REGION_SIZE - 1); }
+    static QString fileName(int region_x, int region_z);
+
+    enum class ReadMode {
+        Buffered, // 用 QFile::read 读入缓冲区
+        Mapped    // 映射整个文件，压缩数据直接从映射内存解压，未压缩数据原地使用
+    };
+
+    // 一个区块解压后的数据。data 指向 buffer，或者在映射模式下读取未压缩数据时直接指向映射内存。
+    // 后者只在同一个 RegionFile 的下一次 read()、prefetch() 或 write() 之前有效：
+    // 文件变长后的读取会重新映射整个文件，旧的映射随之失效。
+    struct Payload {
+        const char* data = nullptr;
+        int size = 0;
+        QByteArray buffer;
+
+        bool isValid() const { return data != nullptr; }
+    };
+
+    explicit RegionFile(const QString& path, ReadMode mode = ReadMode::Buffered);
+    ~RegionFile();
+
+    // 打开文件，不存在时创建一个空的区域文件；文件头损坏时返回 false
+    bool open();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    bool hasChunk(int local_x, int local_z) const { return m_entries[entryIndex(local_x, local_z)].length != 0; }
+
+    // 读取一个区块的数据，不存在或损坏时返回无效的 Payload
+    Payload read(int local_x, int local_z);
+    // 映射模式下提示内核在后台读入一个区块的数据。批量读取时先对整批调用，
+    // 之后的 read() 就不必逐个同步等待磁盘。缓冲模式下什么也不做
+    void prefetch(int local_x, int local_z);
+    // 写入一个区块的数据，compress 为 false 时原样存放
+    bool write(int local_x, int local_z, const QByteArray& data, bool compress = true);
+    // 把已写入的数据刷到磁盘。write() 已经把数据交给操作系统，这里只调用 fsync，
+    // 因此可以与其它线程对同一文件的读写同时进行。成功后，此前被替换的旧扇区可以重新分配
+    bool sync();
+
+    qint64 fileSize() const { return static_cast<qint64>(m_sector_used.size()) * SECTOR_SIZE; }
+
+private:
+    struct Entry {
+        uint32_t sector = 0; // 起始扇区
+        uint32_t length = 0; // 存放的字节数
+        bool raw = false;    // 数据未压缩
+    };
+
+    static int entryIndex(int local_x, int local_z) { return local_z * REGION_SIZE + local_x; }
+    static uint32_t sectorsFor(uint32_t length) { return (length + SECTOR_SIZE - 1) / SECTOR_SIZE; }
+
+    bool writeEntry(int index);
+    // 数据刷盘，保证之后写入的偏移表项不会先于数据落盘
+    bool syncData();
+    // 把已经过 sync() 的旧扇区还给空闲表，只在写入线程调用
+    void reclaimSyncedSectors();
+    uint32_t allocateSectors(uint32_t count);
+    void markSectors(uint32_t first, uint32_t count, bool used);
+    // 保证文件的前 end 个字节已被映射，文件变长后重新映射；失败时退回缓冲读取
+    bool ensureMapped(qint64 end);
+    void unmap();
+
+    QFile m_file;
+    ReadMode m_read_mode;
+    uint32_t m_version = 0;
+    uchar* m_map = nullptr;
+    qint64 m_mapped_size = 0;
+    Entry m_entries[CHUNKS_PER_REGION];
+    std::vector<bool> m_sector_used;
+
+    // 被替换但还不能重新分配的扇区 (起始扇区, 扇区数)。sync() 可能在其它线程调用，由锁保护
+    QMutex m_freed_mutex;
+    std::vector<std::pair<uint32_t, uint32_t>> m_freed_unsynced; // 替换它们的偏移表项还没有刷盘
+    std::vector<std::pair<uint32_t, uint32_t>> m_freed_synced;   // 已经刷盘，下一次分配前归还
+};
+
+#endif // REGIONFILE_H
@@ -0,0 +1,74 @@
+#include "sectionstore.h"
+#include "fnv1a.h"
+
+#include <algorithm>
+
+SectionStore::SectionPtr SectionStore::intern(const SectionPtr& section)
+{
+    const uint64_t hash = contentHash(*section);
+    auto range = m_sections.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        SectionPtr existing = it->second.lock();
+        if (existing == section) return section;
+        if (existing && sameContent(*existing, *section)) return existing;
+    }
+
+    m_sections.emplace(hash, section);
+    if (m_sections.size() > m_purge_threshold) {
+        purgeExpired();
+        m_purge_threshold = std::max<size_t>(1024, m_sections.size() * 2);
+    }
+    return section;
+}
+
+void SectionStore::purgeExpired()
+{
+    for (auto it = m_sections.begin(); it != m_sections.end();) {
+        if (it->second.expired()) it = m_sections.erase(it);
+        else ++it;
+    }
+}
+
+size_t SectionStore::liveCount() const
+{
+    size_t count = 0;
+    for (const auto& entry : m_sections) {
+        if (!entry.second.expired()) ++count;
+    }
+    return count;
+}
+
+size_t SectionStore::liveMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& entry : m_sections) {
+        if (SectionPtr section = entry.second.lock()) bytes += section->memoryUsage();
+    }
+    return bytes;
+}
+
+uint64_t SectionStore::contentHash(const ChunkSection& section)
+{
+    const std::vector<BlockType>& palette = section.blocks.palette();
+    const std::vector<uint64_t>& blocks = section.blocks.packedData();
+    const std::vector<uint8_t>& light = section.light.packedData();
+
+    // 子区块数据最多几 KB，FNV-1a 足够快且分布均匀
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    hash = fnv1a(hash, palette.data(), palette.size() * sizeof(BlockType));
+    hash = fnv1a(hash, blocks.data(), blocks.size() * sizeof(uint64_t));
+    hash = fnv1a(hash, light.data(), light.size());
+    for (const BlockStateStorage::Entry& entry : section.states) {
+        hash = fnv1a(hash, &entry.index, sizeof(entry.index));
+        hash = fnv1a(hash, &entry.state, sizeof(entry.state));
+    }
+    return hash;
+}
+
+bool SectionStore::sameContent(const ChunkSection& a, const ChunkSection& b)
+{
+    return a.blocks.palette() == b.blocks.palette()
+        && a.blocks.packedData() == b.blocks.packedData()
+        && a.light.packedData() == b.light.packedData()
+        && a.states == b.states;
+}
@@ -0,0 +1,39 @@
+#ifndef SECTIONSTORE_H
+#define SECTIONSTORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+#include "chunksection.h"
+
+// 按内容寻址的子区块共享池
+// 地下大片的纯石头子区块、地表以上的纯空气子区块内容完全相同，intern() 让它们
+// 共用同一个实例。共享实例靠引用计数保持不可变：区块写入前发现引用计数大于 1
+// 会先复制（见 Chunk::mutableSection），因此这里只保存弱引用，所有区块都释放后实例自动回收。
+// 比较的是打包后的表示，所以子区块应先 compact()，让相同内容得到相同表示。
+// 只能在拥有这些区块的主线程使用。
+class SectionStore {
+public:
+    using SectionPtr = std::shared_ptr<ChunkSection>;
+
+    // 返回与 section 内容相同的共享实例；池中没有时登记 section 本身并原样返回
+    SectionPtr intern(const SectionPtr& section);
+
+    // 清理已经没有区块引用的条目
+    void purgeExpired();
+
+    // 池中仍然存活的不同子区块数量及其内存占用
+    size_t liveCount() const;
+    size_t liveMemoryUsage() const;
+
+    static uint64_t contentHash(const ChunkSection& section);
+    static bool sameContent(const ChunkSection& a, const ChunkSection& b);
+
+private:
+    std::unordered_multimap<uint64_t, std::weak_ptr<ChunkSection>> m_sections;
+    size_t m_purge_threshold = 1024;
+};
+
+#endif // SECTIONSTORE_H
@@ -0,0 +1,314 @@
+#include "skylight.h"
+
+#include <algorithm>
+
+SkyLight::SkyLight(ChunkMap& chunks)
+    : m_chunks(chunks)
+{
+}
+
+void SkyLight::initializeChunk(Chunk* chunk)
+{
+    const glm::ivec3 chunk_base(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ);
+    const int open_section = chunk->lowestSkyExposedSection();
+    const int open_y = open_section * SECTION_SIZE;
+
+    // 边界两侧不直接暴露在天空下的光照可能已经过期：保存这个区块之后相邻区块又被修改过
+    // （例如封住了洞口），或者相邻区块的光照来自这个区块被修改之前。只把光推过边界
+    // 无法让过亮的光照变暗，所以先把两侧边界列上这部分光照移除，再从仍然有效的光源重新传播。
+    // 正常地形中这部分体素几乎都在实心方块里，光照为 0，不会入队
+    std::queue<LightNode> removal_queue;
+    for (int n = 0; n < NEIGHBOR_COUNT; ++n) {
+        Chunk* neighbor = chunk->neighbors[n];
+        if (!neighbor) continue;
+        clearBorderSkyLight(chunk, n, removal_queue);
+        clearBorderSkyLight(neighbor, OPPOSITE_NEIGHBOR[n], removal_queue);
+    }
+    if (!removal_queue.empty()) removeLight(removal_queue, false);
+
+    if (chunk->is_lit) {
+        // 光照已经算好，只把两侧边界上的天空光互相传播一遍。
+        // 两边都暴露在天空下的高度上光照都是满级，不需要处理
+        for (int n = 0; n < NEIGHBOR_COUNT; ++n) {
+            const Chunk* neighbor = chunk->neighbors[n];
+            if (!neighbor) continue;
+            const int border_top = std::max(open_y, neighbor->lowestSkyExposedSection() * SECTION_SIZE);
+            pushBorderSkyLight(chunk, n, 0, border_top);
+            pushBorderSkyLight(neighbor, OPPOSITE_NEIGHBOR[n], 0, border_top);
+        }
+        chunk->needs_remeshing = true;
+        return;
+    }
+
+    // 整体暴露在天空下的均一子区块直接填满天空光，不逐体素处理
+    for (int s = open_section; s < SECTIONS_PER_CHUNK; ++s) {
+        chunk->mutableSection(s, false).light.fill(MAX_LIGHT_LEVEL, 0);
+    }
+
+    // 与已加载的相邻区块缝合：
+    // 本区块暴露在天空下的部分朝向相邻区块未暴露的高度传播；
+    // 反过来，相邻区块边界上已有的天空光也要传进本区块 open_y 以下的部分
+    for (int n = 0; n < NEIGHBOR_COUNT; ++n) {
+        const Chunk* neighbor = chunk->neighbors[n];
+        if (!neighbor) continue;
+        const int neighbor_open_y = neighbor->lowestSkyExposedSection() * SECTION_SIZE;
+
+        pushBorderSkyLight(chunk, n, open_y, neighbor_open_y);
+        pushBorderSkyLight(neighbor, OPPOSITE_NEIGHBOR[n], 0, open_y);
+    }
+
+    // 剩下的部分逐列向下填充，直到高度图给出的最高不透明方块
+    for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
+        for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
+            const int opaque_height = chunk->opaqueHeight(x, z);
+            for (int y = open_y - 1; y >= opaque_height; --y) {
+                chunk->setSkyLight(x, y, z, MAX_LIGHT_LEVEL, false);
+                m_queue.push({chunk_base + glm::ivec3(x, y, z), MAX_LIGHT_LEVEL});
+            }
+        }
+    }
+
+    chunk->needs_remeshing = true;
+}
+
+void SkyLight::pushBorderSkyLight(const Chunk* chunk, int side, int min_y, int max_y)
+{
+    const glm::ivec3 chunk_base(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ);
+    for (int y = min_y; y < max_y; ++y) {
+        for (int i = 0; i < CHUNK_SIZE_XZ; ++i) {
+            glm::ivec3 local_pos;
+            switch (side) {
+            case NEIGHBOR_POS_X: local_pos = glm::ivec3(CHUNK_SIZE_XZ - 1, y, i); break;
+            case NEIGHBOR_NEG_X: local_pos = glm::ivec3(0, y, i); break;
+            case NEIGHBOR_POS_Z: local_pos = glm::ivec3(i, y, CHUNK_SIZE_XZ - 1); break;
+            default:             local_pos = glm::ivec3(i, y, 0); break;
+            }
+            uint8_t level = chunk->getSkyLight(local_pos.x, local_pos.y, local_pos.z);
+            if (level > 1) {
+                m_queue.push({chunk_base + local_pos, level});
+            }
+        }
+    }
+}
+
+void SkyLight::clearBorderSkyLight(Chunk* chunk, int side, std::queue<LightNode>& removal_queue)
+{
+    const glm::ivec3 chunk_base(chunk->coords.x * CHUNK_SIZE_XZ, 0, chunk->coords.z * CHUNK_SIZE_XZ);
+    for (int i = 0; i < CHUNK_SIZE_XZ; ++i) {
+        int x, z;
+        switch (side) {
+        case NEIGHBOR_POS_X: x = CHUNK_SIZE_XZ - 1; z = i; break;
+        case NEIGHBOR_NEG_X: x = 0; z = i; break;
+        case NEIGHBOR_POS_Z: x = i; z = CHUNK_SIZE_XZ - 1; break;
+        default:             x = i; z = 0; break;
+        }
+        // 最高不透明方块之上直接暴露在天空下，光照只取决于本列，不会过期
+        const int opaque_height = chunk->opaqueHeight(x, z);
+        for (int y = 0; y < opaque_height; ++y) {
+            const uint8_t level = chunk->getSkyLight(x, y, z);
+            if (level == 0) continue;
+            chunk->setSkyLight(x, y, z, 0, false);
+            chunk->needs_remeshing = true;
+            removal_queue.push({chunk_base + glm::ivec3(x, y, z), level});
+        }
+    }
+}
+
+void SkyLight::updateBlock(const glm::ivec3& world_pos, BlockType old_type)
+{
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return;
+    const BlockType block_id = chunk->getBlock(local_pos.x, local_pos.y, local_pos.z);
+    // 方块本身的光照没有随方块一起修改，仍是修改前的值
+    const uint8_t old_light_level = chunk->getSkyLight(local_pos.x, local_pos.y, local_pos.z);
+
+    // 队列里可能还有旧的、待处理的节点（例如刚加载的区块的天空光）。
+    // 它们不能被清空，propagateLight 会跳过光照已经变化的过期节点，
+    // 因此不会覆盖下面由方块修改直接触发的更新。
+
+    bool was_transparent = !isOpaque(old_type);
+    bool is_transparent = !isOpaque(block_id);
+
+    if (was_transparent == is_transparent) {
+        // 透明度未变，光照逻辑不变
+    }
+    else if (!is_transparent) {
+        // 放置不透明方块 -> 移除光线
+        if (old_light_level > 0) {
+            std::queue<LightNode> light_removal_queue;
+            light_removal_queue.push({world_pos, old_light_level});
+            setSkyLight(world_pos, 0);
+            removeLight(light_removal_queue, true);
+        }
+    }
+    else {
+        // 移除不透明方块 -> 传播光线
+        std::queue<LightNode> light_propagation_queue;
+        uint8_t max_neighbor_light = 0;
+        const glm::ivec3 neighbors[6] = {
+            {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
+        };
+        for (const auto& offset : neighbors) {
+            max_neighbor_light = std::max(max_neighbor_light, getSkyLight(world_pos + offset));
+        }
+
+        uint8_t new_light_level = 0;
+        if (max_neighbor_light > 0) {
+            new_light_level = max_neighbor_light - 1;
+        }
+
+        // 高度图已经随方块修改更新，暴露在天空下等价于位于最高不透明方块之上
+        const int opaque_height = chunk->opaqueHeight(local_pos.x, local_pos.z);
+        bool exposed_to_sky = world_pos.y >= opaque_height;
+
+        if (exposed_to_sky) {
+            new_light_level = 15;
+            for (int y = world_pos.y; y >= opaque_height; --y) {
+                glm::ivec3 current_pos(world_pos.x, y, world_pos.z);
+                if (getSkyLight(current_pos) < 15) {
+                    setSkyLight(current_pos, 15);
+                    light_propagation_queue.push({current_pos, 15});
+                }
+            }
+        }
+
+        uint8_t current_light = getSkyLight(world_pos);
+        if (new_light_level > current_light) {
+            setSkyLight(world_pos, new_light_level);
+            light_propagation_queue.push({world_pos, new_light_level});
+        }
+
+        if (!light_propagation_queue.empty()) {
+            propagateLight(light_propagation_queue, true);
+        }
+    }
+}
+
+void SkyLight::propagate(int max_steps)
+{
+    // 队列中只有插入区块时入队的节点
+    propagateLight(m_queue, false, max_steps);
+}
+
+Chunk* SkyLight::findChunkForBlock(const glm::ivec3& world_pos, glm::ivec3& local_pos) const
+{
+    if (world_pos.y < 0 || world_pos.y >= WORLD_HEIGHT_IN_BLOCKS) return nullptr;
+
+    Chunk* chunk = m_chunks.find(blockToChunk(world_pos.x), blockToChunk(world_pos.z));
+    if (!chunk) return nullptr;
+
+    local_pos = glm::ivec3(blockToLocal(world_pos.x), world_pos.y, blockToLocal(world_pos.z));
+    return chunk;
+}
+
+uint8_t SkyLight::getSkyLight(const glm::ivec3& world_pos) const
+{
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return 0;
+    return chunk->getSkyLight(local_pos.x, local_pos.y, local_pos.z);
+}
+
+void SkyLight::setSkyLight(const glm::ivec3& world_pos, uint8_t level)
+{
+    glm::ivec3 local_pos;
+    Chunk* chunk = findChunkForBlock(world_pos, local_pos);
+    if (!chunk) return;
+
+    if (chunk->getSkyLight(local_pos.x, local_pos.y, local_pos.z) != level) {
+        chunk->setSkyLight(local_pos.x, local_pos.y, local_pos.z, level);
+        chunk->needs_remeshing = true;
+    }
+}
+
+void SkyLight::removeLight(std::queue<LightNode>& removal_queue, bool mark_dirty)
+{
+    const glm::ivec3 neighbors[6] = {
+        {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
+    };
+
+    std::queue<LightNode> propagation_queue;
+
+    while (!removal_queue.empty()) {
+        auto [pos, light_level] = removal_queue.front();
+        removal_queue.pop();
+
+        glm::ivec3 local_pos;
+        Chunk* chunk = findChunkForBlock(pos, local_pos);
+        if (!chunk) continue;
+
+        for (const auto& offset : neighbors) {
+            // 通过邻居链接解析相邻体素，跨区块边界时也不需要再查哈希表
+            int nx = local_pos.x + offset.x, ny = local_pos.y + offset.y, nz = local_pos.z + offset.z;
+            if (ny < 0 || ny >= WORLD_HEIGHT_IN_BLOCKS) continue;
+            Chunk* neighbor_chunk = chunk->resolveNeighbor(nx, nz);
+            if (!neighbor_chunk) continue;
+
+            uint8_t neighbor_light = neighbor_chunk->getSkyLight(nx, ny, nz);
+
+            // 如果邻居没有光，直接跳过
+            if (neighbor_light == 0) {
+                continue;
+            }
+
+            // BUG 修复:
+            // 旧的逻辑是 `neighbor_light > light_level`，这会忽略 `neighbor_light == light_level` 的情况，
+            // 导致移除阳光(level 15)时，无法正确处理同样是level 15的邻居，光照移除中断。
+            //
+            // 新的逻辑:
+            // 如果邻居的光照等级严格小于我们正在移除的光源等级，那么它之前可能是被这个光源照亮的。
+            // 现在光源没了，它的光也需要被移除并重新计算。
+            if (neighbor_light < light_level) {
+                neighbor_chunk->setSkyLight(nx, ny, nz, 0, mark_dirty);
+                neighbor_chunk->needs_remeshing = true;
+                removal_queue.push({pos + offset, neighbor_light});
+            }
+            // 如果邻居的光照等级大于或等于我们移除的光源等级，说明它有独立的、更强或同样强的光源。
+            // 它现在应该成为一个新的光源，去尝试照亮刚刚变暗的区域。
+            else { // 这等同于 if (neighbor_light >= light_level)
+                propagation_queue.push({pos + offset, neighbor_light});
+            }
+        }
+    }
+
+    // 在所有需要移除的光被移除后，从边界上的光源开始重新传播光线。
+    propagateLight(propagation_queue, mark_dirty);
+}
+
+void SkyLight::propagateLight(std::queue<LightNode>& propagation_queue, bool mark_dirty, int max_steps)
+{
+    const glm::ivec3 neighbors[6] = {
+        {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}
+    };
+
+    for (int step = 0; step < max_steps && !propagation_queue.empty(); ++step) {
+        auto [pos, light_level] = propagation_queue.front();
+        propagation_queue.pop();
+
+        if (light_level <= 1) continue;
+
+        glm::ivec3 local_pos;
+        Chunk* chunk = findChunkForBlock(pos, local_pos);
+        if (!chunk) continue;
+        // 入队之后这个体素的光照又被修改过（被移除或被更强的光覆盖），这个节点已经过期
+        if (chunk->getSkyLight(local_pos.x, local_pos.y, local_pos.z) != light_level) continue;
+
+        for (const auto& offset : neighbors) {
+            int nx = local_pos.x + offset.x, ny = local_pos.y + offset.y, nz = local_pos.z + offset.z;
+            if (ny < 0 || ny >= WORLD_HEIGHT_IN_BLOCKS) continue;
+            Chunk* neighbor_chunk = chunk->resolveNeighbor(nx, nz);
+            if (!neighbor_chunk) continue;
+
+            // 不透明方块的衰减为 15，算出的光照不会大于 0，因此不需要单独判断透明度
+            const int attenuation = blockProperties(neighbor_chunk->getBlock(nx, ny, nz)).light_attenuation;
+            const int new_level = light_level - attenuation;
+
+            if (neighbor_chunk->getSkyLight(nx, ny, nz) < new_level) {
+                neighbor_chunk->setSkyLight(nx, ny, nz, static_cast<uint8_t>(new_level), mark_dirty);
+                neighbor_chunk->needs_remeshing = true;
+                propagation_queue.push({pos + offset, static_cast<uint8_t>(new_level)});
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SKYLIGHT_H
+#define SKYLIGHT_H
+
+#include <cstdint>
+#include <limits>
+#include <queue>
+
+#include <glm/glm.hpp>
+
+#include "block.h"
+#include "chunk.h"
+#include "chunkmap.h"
+
+// 用于在洪水填充算法中传递方块位置和光照等级，比 std::pair 更清晰
+struct LightNode {
+    glm::ivec3 pos;
+    uint8_t level;
+};
+
+// 天空光计算
+// 区块插入 ChunkMap 之后由 initializeChunk 填充直射的天空光并与已加载的相邻区块缝合，
+// 还需要扩散的节点留在内部队列中，由 propagate 分批处理；方块修改由 updateBlock 同步处理。
+// 光照传播到未加载的区块就停下。光照改变过的区块被标记为需要重建网格。
+// 插入区块引起的光照计算（包括之后分批传播的部分）可以在下次插入时重新算出来，
+// 不让区块变脏；方块修改引起的光照变化和方块一样让区块变脏。
+// 只读写 ChunkMap 中的区块，不涉及 OpenGL，游戏和预生成工具共用这一份实现。
+// 不是线程安全的。
+class SkyLight {
+public:
+    explicit SkyLight(ChunkMap& chunks);
+
+    // chunk 刚插入 ChunkMap、邻居链接已经建立时调用
+    void initializeChunk(Chunk* chunk);
+    // world_pos 处的方块刚从 old_type 改成现在的方块（高度图已更新），同步更新周围的天空光
+    void updateBlock(const glm::ivec3& world_pos, BlockType old_type);
+    // 处理内部队列中最多 max_steps 个节点
+    void propagate(int max_steps = std::numeric_limits<int>::max());
+
+    // 队列为空时，已加载区块的光照不会再因为之前的插入而改变
+    bool isSettled() const { return m_queue.empty(); }
+    size_t pendingNodes() const { return m_queue.size(); }
+
+private:
+    Chunk* findChunkForBlock(const glm::ivec3& world_pos, glm::ivec3& local_pos) const;
+    uint8_t getSkyLight(const glm::ivec3& world_pos) const;
+    void setSkyLight(const glm::ivec3& world_pos, uint8_t level);
+
+    // 把 chunk 朝向 side 一侧边界上 [min_y, max_y) 范围内还能继续传播的天空光入队
+    void pushBorderSkyLight(const Chunk* chunk, int side, int min_y, int max_y);
+    // 把 chunk 朝向 side 一侧边界列上不直接暴露在天空下、有光照的体素清零并加入移除队列
+    void clearBorderSkyLight(Chunk* chunk, int side, std::queue<LightNode>& removal_queue);
+    // mark_dirty 见 Chunk::mutableSection
+    void removeLight(std::queue<LightNode>& removal_queue, bool mark_dirty);
+    void propagateLight(std::queue<LightNode>& propagation_queue, bool mark_dirty,
+                        int max_steps = std::numeric_limits<int>::max());
+
+    ChunkMap& m_chunks;
+    std::queue<LightNode> m_queue;
+};
+
+#endif // SKYLIGHT_H
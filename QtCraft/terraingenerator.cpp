@@ -0,0 +1,76 @@
+#include "terraingenerator.h"
+
+#include "FastNoiseLite.h"
+
+void TerrainGenerator::generate(Chunk& chunk) const
+{
+    const glm::ivec3& chunk_coords = chunk.coords;
+
+    // 所有噪声都使用世界种子；默认种子下的结果与引入种子之前完全相同
+    FastNoiseLite noise(m_seed);
+    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+
+    FastNoiseLite distortion_noise(m_seed);
+    distortion_noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    distortion_noise.SetFrequency(0.05f);
+
+    int octaves = 5;
+    float persistence = 0.5f;
+    float lacunarity = 2.2f;
+    float base_frequency = 0.1f;
+    float base_amplitude = 20.0f;
+    float distortion_strength = 10.0f;
+
+    for (int x = 0; x < CHUNK_SIZE_XZ; ++x) {
+        for (int z = 0; z < CHUNK_SIZE_XZ; ++z) {
+            int world_x = chunk_coords.x * CHUNK_SIZE_XZ + x;
+            int world_z = chunk_coords.z * CHUNK_SIZE_XZ + z;
+
+            float distortion_x = distortion_noise.GetNoise((float)world_x, (float)world_z) * distortion_strength;
+            float distortion_z = distortion_noise.GetNoise((float)world_x + 543.21f, (float)world_z - 123.45f) * distortion_strength;
+
+            float total_noise = 0.0f;
+            float frequency = base_frequency;
+            float amplitude = base_amplitude;
+
+            for (int i = 0; i < octaves; ++i) {
+                total_noise += noise.GetNoise(
+                                   (float)world_x * frequency + distortion_x,
+                                   (float)world_z * frequency + distortion_z
+                                   ) * amplitude;
+                amplitude *= persistence;
+                frequency *= lacunarity;
+            }
+            int sea_level = 8;
+            int terrain_height = static_cast<int>(total_noise) + sea_level;
+
+            // 遍历整个区块高度
+            for (int y = 0; y < WORLD_HEIGHT_IN_BLOCKS; ++y) {
+                int world_y = y; // 世界y坐标就是区块内的y坐标
+
+                BlockType blockToPlace = BlockType::Air;
+                if (world_y > terrain_height) {
+                    if (world_y <= sea_level) {
+                        blockToPlace = BlockType::Water;
+                    }
+                } else {
+                    if (world_y == terrain_height && world_y > sea_level) {
+                        blockToPlace = BlockType::Grass;
+                    } else if (world_y > terrain_height - 5) {
+                        blockToPlace = BlockType::Dirt;
+                    } else {
+                        blockToPlace = BlockType::Stone;
+                    }
+                }
+                // 注意数组索引顺序
+                chunk.setBlock(x, y, z, blockToPlace);
+            }
+        }
+    }
+
+    // 地表以上的空气和地下深处的石头会被压缩为均一子区块
+    chunk.compactSections();
+    chunk.rebuildHeightmaps();
+    // 自动保存和卸载只写修改过的区块，只是被探索到的区块不写入存档
+    chunk.markSaved(chunk.generation());
+}
@@ -0,0 +1,28 @@
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include "chunk.h"
+
+// 地形生成：由噪声决定每列的地表高度，再按高度分层填充石头、泥土、草和水。
+// 结果只取决于种子和区块坐标，不读写任何共享状态，可以在多个线程上同时调用。
+// 游戏和无界面的预生成工具共用这一份实现。
+class TerrainGenerator {
+public:
+    // FastNoiseLite 的默认种子，引入种子之前生成的世界都使用它
+    static const int DEFAULT_SEED = 1337;
+
+    explicit TerrainGenerator(int seed = DEFAULT_SEED) : m_seed(seed) {}
+
+    // 只能在没有生成任务进行时修改
+    void setSeed(int seed) { m_seed = seed; }
+    int seed() const { return m_seed; }
+
+    // 生成 chunk.coords 处的区块柱，chunk 必须是空的（刚 reset() 过）。
+    // 生成的内容随时可以由种子重新生成，结果不算未保存的修改（见 Chunk::isDirty）
+    void generate(Chunk& chunk) const;
+
+private:
+    int m_seed;
+};
+
+#endif // TERRAINGENERATOR_H
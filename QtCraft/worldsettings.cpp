@@ -0,0 +1,61 @@
+#include "worldsettings.h"
+#include "terraingenerator.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QSettings>
+#include <QStringList>
+
+namespace {
+const char* const SETTINGS_FILE = "world.ini";
+const char* const SEED_KEY = "world/seed";
+const char* const RAW_CHUNKS_KEY = "storage/raw";
+}
+
+int WorldSettings::resolveSeed(const QString& directory, bool has_requested, int requested)
+{
+    QDir dir(directory);
+    QSettings settings(dir.filePath(SETTINGS_FILE), QSettings::IniFormat);
+
+    if (settings.contains(SEED_KEY)) {
+        bool ok = false;
+        const int seed = settings.value(SEED_KEY).toInt(&ok);
+        if (ok) {
+            if (has_requested && requested != seed) {
+                qWarning() << "存档" << directory << "使用种子" << seed << "，忽略指定的种子" << requested;
+            }
+            return seed;
+        }
+        qWarning() << "存档" << directory << "记录的种子无效，改用默认种子";
+    }
+
+    const int default_seed = TerrainGenerator::DEFAULT_SEED;
+    int seed = has_requested ? requested : default_seed;
+    const bool has_regions = !dir.entryList(QStringList() << "*.region", QDir::Files).isEmpty();
+    if (has_regions && seed != default_seed) {
+        // 旧存档里的区块都是用默认种子生成的，换种子会在已生成和新生成的区块之间留下断层
+        qWarning() << "存档" << directory << "创建于引入种子之前，只能使用默认种子" << default_seed;
+        seed = default_seed;
+    }
+
+    settings.setValue(SEED_KEY, seed);
+    settings.sync();
+    return seed;
+}
+
+bool WorldSettings::rawChunks(const QString& directory)
+{
+    QSettings settings(QDir(directory).filePath(SETTINGS_FILE), QSettings::IniFormat);
+    return settings.value(RAW_CHUNKS_KEY, false).toBool();
+}
+
+void WorldSettings::setRawChunks(const QString& directory, bool raw)
+{
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "无法创建存档目录" << directory;
+        return;
+    }
+    QSettings settings(QDir(directory).filePath(SETTINGS_FILE), QSettings::IniFormat);
+    settings.setValue(RAW_CHUNKS_KEY, raw);
+    settings.sync();
+}
@@ -0,0 +1,20 @@
+#ifndef WORLDSETTINGS_H
+#define WORLDSETTINGS_H
+
+#include <QString>
+
+// 存档目录中与区块数据无关的世界参数，保存在 world.ini 中
+class WorldSettings {
+public:
+    // 确定存档使用的世界种子。已有存档总是沿用记录的种子，has_requested 时若与 requested 不同给出警告；
+    // 新存档使用 requested（没有指定时用默认种子）并立即记录下来。
+    // 引入种子之前创建的存档没有 world.ini，但已经有区域文件，它们按默认种子处理。
+    static int resolveSeed(const QString& directory, bool has_requested, int requested);
+
+    // 存档中的区块是否不压缩保存（见 ChunkStorage），没有记录时为 false。
+    // 由预生成工具的 --raw 打开，游戏打开存档时沿用，之后保存的区块也不压缩
+    static bool rawChunks(const QString& directory);
+    static void setRawChunks(const QString& directory, bool raw);
+};
+
+#endif // WORLDSETTINGS_H
@@ -0,0 +1,16 @@
+#include "worldview.h"
+
+WorldView::WorldView(const ChunkMap& chunks, const glm::ivec3& min, const glm::ivec3& max)
+    : m_map(chunks)
+    , m_min(glm::min(min, max))
+    , m_max(glm::max(min, max))
+{
+    m_min_chunk_x = blockToChunk(m_min.x);
+    m_min_chunk_z = blockToChunk(m_min.z);
+    m_size_x = blockToChunk(m_max.x) - m_min_chunk_x + 1;
+    m_size_z = blockToChunk(m_max.z) - m_min_chunk_z + 1;
+
+    const size_t count = static_cast<size_t>(m_size_x) * static_cast<size_t>(m_size_z);
+    m_chunks.assign(count, nullptr);
+    m_resolved.assign(count, false);
+}
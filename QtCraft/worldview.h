@@ -0,0 +1,83 @@
+#ifndef WORLDVIEW_H
+#define WORLDVIEW_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+#include "chunkmap.h"
+
+// 世界空间中一个长方体区域的只读视图
+// 构造时只记录区域覆盖的区块范围，每个区块在第一次读取时才查哈希表并缓存，
+// 之后区域内的读取只剩移位、掩码和一次数组下标。适合碰撞检测、射线检测这类
+// 在小范围内反复读取方块的代码。区域外的读取退回到 ChunkMap::find，结果仍然正确。
+// 视图只在区块集合不变期间有效，不要跨帧保存。
+class WorldView {
+public:
+    // min、max 都包含在区域内
+    WorldView(const ChunkMap& chunks, const glm::ivec3& min, const glm::ivec3& max);
+
+    // 世界上下边界外以及未加载的区块都视为空气
+    BlockType getBlock(int x, int y, int z) const {
+        if (y < 0 || y >= WORLD_HEIGHT_IN_BLOCKS) return BlockType::Air;
+        const Chunk* chunk = chunkAt(blockToChunk(x), blockToChunk(z));
+        return chunk ? chunk->getBlock(blockToLocal(x), y, blockToLocal(z)) : BlockType::Air;
+    }
+    BlockType getBlock(const glm::ivec3& pos) const { return getBlock(pos.x, pos.y, pos.z); }
+
+    // 按区块逐个遍历区域内（并且在世界高度内）的每个方块，fn(const glm::ivec3& world_pos, BlockType)。
+    // 每个区块只解析一次，区块内按存储顺序 (y, z, x) 访问。未加载的区块被跳过。
+    // 遍历的是构造时的区域：调用者在遍历过程中移动了要查询的包围盒（例如碰撞检测把玩家推出方块）时，
+    // 遍历结果对新位置无效，应该改用 getBlock 逐个读取，或者按新位置重新构造视图。
+    template <typename Fn>
+    void forEachBlock(Fn&& fn) const {
+        const int min_y = glm::max(m_min.y, 0);
+        const int max_y = glm::min(m_max.y, WORLD_HEIGHT_IN_BLOCKS - 1);
+        for (int cz = m_min_chunk_z; cz < m_min_chunk_z + m_size_z; ++cz) {
+            for (int cx = m_min_chunk_x; cx < m_min_chunk_x + m_size_x; ++cx) {
+                const Chunk* chunk = chunkAt(cx, cz);
+                if (!chunk) continue;
+                const int min_x = glm::max(m_min.x, cx * CHUNK_SIZE_XZ);
+                const int max_x = glm::min(m_max.x, (cx * CHUNK_SIZE_XZ) + CHUNK_MASK);
+                const int min_z = glm::max(m_min.z, cz * CHUNK_SIZE_XZ);
+                const int max_z = glm::min(m_max.z, (cz * CHUNK_SIZE_XZ) + CHUNK_MASK);
+                for (int y = min_y; y <= max_y; ++y) {
+                    for (int z = min_z; z <= max_z; ++z) {
+                        for (int x = min_x; x <= max_x; ++x) {
+                            fn(glm::ivec3(x, y, z), chunk->getBlock(blockToLocal(x), y, blockToLocal(z)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const Chunk* chunkAt(int chunk_x, int chunk_z) const {
+        // 无符号比较同时排除了下界和上界之外的情况
+        const unsigned dx = static_cast<unsigned>(chunk_x - m_min_chunk_x);
+        const unsigned dz = static_cast<unsigned>(chunk_z - m_min_chunk_z);
+        if (dx >= static_cast<unsigned>(m_size_x) || dz >= static_cast<unsigned>(m_size_z)) {
+            return m_map.find(chunk_x, chunk_z);
+        }
+        const size_t index = dz * m_size_x + dx;
+        if (!m_resolved[index]) {
+            m_chunks[index] = m_map.find(chunk_x, chunk_z);
+            m_resolved[index] = true;
+        }
+        return m_chunks[index];
+    }
+
+    const ChunkMap& m_map;
+    glm::ivec3 m_min;
+    glm::ivec3 m_max;
+    int m_min_chunk_x;
+    int m_min_chunk_z;
+    int m_size_x;
+    int m_size_z;
+    mutable std::vector<const Chunk*> m_chunks;
+    mutable std::vector<bool> m_resolved;
+};
+
+#endif // WORLDVIEW_H